@@ -0,0 +1,83 @@
+#include "airtime.h"
+#include <cmath>
+
+using namespace RN;
+
+Airtime::Airtime() :
+	_mod(Mod::RNFSK),
+	_rate(2500),
+	_sf(12),
+	_bw(125000),
+	_cr(5),
+	_prlen(8),
+	_szSync(1),
+	_crc(false)
+{
+}
+
+void Airtime::SetMod(Mod modulation)
+{
+	_mod = modulation;
+}
+
+bool Airtime::SetBitRate(unsigned int rate)
+{
+	if (!rate)
+	{
+		return false;
+	}
+
+	_rate = rate;
+
+	return true;
+}
+
+bool Airtime::SetLoRa(unsigned char sf, unsigned int bw, unsigned char cr)
+{
+	if (sf < 7 || sf > 12 || !bw || cr < 5 || cr > 8)
+	{
+		return false;
+	}
+
+	_sf = sf;
+	_bw = bw;
+	_cr = cr;
+
+	return true;
+}
+
+void Airtime::SetPreambleLength(unsigned int length)
+{
+	_prlen = length;
+}
+
+void Airtime::SetSzSync(size_t sz)
+{
+	_szSync = sz;
+}
+
+void Airtime::SetCRC(bool state)
+{
+	_crc = state;
+}
+
+double Airtime::Frame(size_t sz)
+{
+	if (_mod == Mod::RNFSK)
+	{
+		// preamble, sync word, length byte, payload and CRC
+
+		size_t bits = 8 * (_prlen + _szSync + 1 + sz + (_crc ? 2 : 0));
+
+		return static_cast<double>(bits) / _rate;
+	}
+
+	// LORA with explicit header, low data rate optimization for symbols longer than 16 ms (Semtech AN1200.13)
+
+	double tSym = pow(2.0, _sf) / _bw;
+	int de = tSym > 0.016 ? 1 : 0;
+	double num = 8.0 * sz - 4.0 * _sf + 28.0 + (_crc ? 16.0 : 0.0);
+	double nPayload = 8.0 + fmax(ceil(num / (4.0 * (_sf - 2 * de))) * _cr, 0.0);
+
+	return (_prlen + 4.25) * tSym + nPayload * tSym;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+
+#include "rn2483.h"
+
+namespace RN
+{
+	// Air time of radio frames computed from settings of RN2483 (modulation, bit rate or spreading
+	// factor, preamble length, sync word length and CRC). FSK frame consists of preamble, sync word,
+	// length byte, payload and CRC, LORA frame uses explicit header.
+	class Airtime
+	{
+		public:
+			// Default class constructor (FSK with settings applied by RN2483::Init).
+			Airtime();
+
+			// Set modulation.
+			// modulation: FSK or LORA.
+			void SetMod(Mod modulation);
+
+			// Set bit rate of FSK modulation.
+			// rate: Bit rate [bit/second].
+			// Returns true on success, false if bit rate is 0.
+			bool SetBitRate(unsigned int rate);
+
+			// Set parameters of LORA modulation.
+			// sf: Spreading factor (7 to 12).
+			// bw: Bandwidth [Hz].
+			// cr: Denominator of coding rate 4/cr (5 to 8).
+			// Returns true on success, false if parameters are out of range.
+			bool SetLoRa(unsigned char sf, unsigned int bw, unsigned char cr);
+
+			// Set preamble length.
+			// length: Preamble length [byte for FSK, symbol for LORA].
+			void SetPreambleLength(unsigned int length);
+
+			// Set size of sync word (FSK only).
+			// sz: Size of sync word [byte].
+			void SetSzSync(size_t sz);
+
+			// Set if CRC is appended to frame.
+			// state: CRC is on.
+			void SetCRC(bool state);
+
+			// Air time of frame.
+			// sz: Size of payload [byte].
+			// Returns time from start of preamble to end of frame [second].
+			double Frame(size_t sz);
+
+		private:
+			Mod _mod;			// Modulation.
+			unsigned int _rate;		// Bit rate of FSK [bit/second].
+			unsigned char _sf;		// Spreading factor of LORA.
+			unsigned int _bw;		// Bandwidth of LORA [Hz].
+			unsigned char _cr;		// Denominator of coding rate of LORA.
+			unsigned int _prlen;		// Preamble length [byte or symbol].
+			size_t _szSync;			// Size of sync word [byte].
+			bool _crc;			// CRC is appended to frame.
+	};
+};
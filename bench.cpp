@@ -0,0 +1,213 @@
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+#include <fcntl.h>
+#include <openssl/rsa.h>
+
+#include "clock.h"
+#include "tools.h"
+#include "packet.h"
+#include "fec.h"
+#include "framer.h"
+
+#define TIME 0.5
+#define FRAME 255
+#define PACKET 63
+#define KEYBITS 1024
+#define BLOCKS 4
+
+using namespace std;
+using namespace RN;
+
+// Keeps results of benchmarked operations so they are not optimized out.
+static volatile size_t _sink;
+
+// Run operation repeatedly for about TIME seconds and print its speed.
+// pName: Name of benchmark.
+// szOp: Number of bytes processed by one operation.
+// op: Benchmarked operation.
+template<typename Op>
+static void _bench(const char *pName, size_t szOp, Op op)
+{
+	// warm up caches and branch predictors
+
+	for (unsigned int i = 0; i < 16; i++)
+	{
+		op();
+	}
+
+	Clock clk;
+	size_t count = 0;
+	size_t batch = 1;
+	double elapsed;
+	do
+	{
+		for (size_t i = 0; i < batch; i++)
+		{
+			op();
+		}
+		count += batch;
+		batch *= 2;
+		elapsed = clk.Now();
+	} while (elapsed < TIME);
+
+	double ns = elapsed * 1e9 / count;
+	printf("%-32s %10.2f ns/byte %14.0f ops/s\n", pName, szOp ? ns / szOp : 0.0, count / elapsed);
+}
+
+int main()
+{
+	char data[FRAME];
+	char hex[2 * FRAME];
+	char out[FRAME];
+	for (size_t i = 0; i < FRAME; i++)
+	{
+		data[i] = i * 151 + 7;
+	}
+	D2H(data, FRAME, hex);
+
+	// hex translation of largest radio frame
+
+	_bench("D2H", FRAME, [&]() { _sink += D2H(data, FRAME, hex); data[0]++; });
+	_bench("D2HScalar", FRAME, [&]() { _sink += D2HScalar(data, FRAME, hex); data[0]++; });
+	_bench("H2D", 2 * FRAME, [&]() { _sink += H2D(hex, 2 * FRAME, out, FRAME); hex[0] ^= 1; });
+	_bench("H2DScalar", 2 * FRAME, [&]() { _sink += H2DScalar(hex, 2 * FRAME, out, FRAME); hex[0] ^= 1; });
+
+	// response matching
+
+	string rx = string("radio_rx  ") + string(hex, 2 * FRAME);
+	const char *pRX = rx.data();
+	_bench("bcmp ok", 2, [&]() { _sink += bcmp("ok", "ok\r\n"); });
+	_bench("bcmp radio_rx", 10, [&]() { _sink += bcmp(pRX, "radio_rx  "); });
+	_bench("bcmp radio_err", 9, [&]() { _sink += bcmp("radio_err", pRX); });
+	_bench("bncmp radio_rx", 10, [&]() { _sink += bncmp(pRX, "radio_rx  ", 10); });
+
+	// frame assembly as in Comm::_transmit (packet info, data and parity) followed by hex for radio tx
+
+	char frame[PACKET + 32];
+	char frameHex[2 * sizeof(frame)];
+	PacketInfoPart part;
+	memset(&part, 0, sizeof(part));
+	part.LocalId = 21;
+	part.RemoteId = 20;
+	part.Port = 10;
+	part.Session = 1;
+	part.Size = PACKET - SZ_INFO_PART;
+
+	for (unsigned char parity = 0; parity <= 8; parity += 8)
+	{
+		FEC fec;
+		fec.SetParity(parity);
+
+		char name[64];
+		sprintf(name, "frame assembly fec(%u)", parity);
+		_bench(name, PACKET, [&]()
+		{
+			part.SegId = part.SegId % 255 + 1;
+			size_t szInfo = EncodePart(&part, frame);
+			memcpy(frame + szInfo, data, part.Size);
+			size_t szFrame = fec.Encode(frame, szInfo + part.Size);
+			_sink += D2H(frame, szFrame, frameHex);
+		});
+	}
+
+	// response parsing as in RN2483 (bytes from descriptor, line framing and decoding)
+
+	string lines;
+	for (unsigned int i = 0; i < 8; i++)
+	{
+		lines += "ok\r\nradio_tx_ok\r\n2500\r\n";
+		lines += rx + "\r\n";
+	}
+
+	int fds[2];
+	if (pipe(fds) != 0)
+	{
+		return -1;
+	}
+	fcntl(fds[0], F_SETFL, O_NONBLOCK);
+
+	Framer framer;
+	_bench("response parsing", lines.size(), [&]()
+	{
+		ssize_t szWrite = write(fds[1], lines.data(), lines.size());
+		if (szWrite != static_cast<ssize_t>(lines.size()))
+		{
+			return;
+		}
+
+		// lines may not fit into ring at once
+		bool more = true;
+		while (more)
+		{
+			more = false;
+			framer.Fill(fds[0]);
+
+			size_t szLine;
+			char *pLine;
+			while ((pLine = framer.Next(&szLine)))
+			{
+				more = true;
+
+				unsigned int value;
+				if (bcmp(pLine, "radio_rx  ") == 0)
+				{
+					_sink += H2D(pLine + 10, szLine - 10, out, FRAME);
+				}
+				else if (bcmp(pLine, "ok\r\n") == 0 || bcmp(pLine, "radio_tx_ok\r\n") == 0)
+				{
+					_sink++;
+				}
+				else if (sscanf(pLine, "%u", &value) == 1)
+				{
+					_sink += value;
+				}
+			}
+		}
+	});
+
+	close(fds[0]);
+	close(fds[1]);
+
+	// RSA blocks as in EncryptPubSend and ReceiveDecryptPvt
+
+	RSA *pRSA = RSA_new();
+	BIGNUM *pBN = BN_new();
+	BN_set_word(pBN, RSA_F4);
+	if (!RSA_generate_key_ex(pRSA, KEYBITS, pBN, NULL))
+	{
+		return -1;
+	}
+
+	size_t szRSAPub = RSA_size(pRSA);
+	size_t szRSAPvt = szRSAPub - 12;
+	string plain(BLOCKS * szRSAPvt, 'x');
+	string encrypted(BLOCKS * szRSAPub, '\0');
+	string decrypted(BLOCKS * szRSAPvt, '\0');
+
+	const unsigned char *pPlain = reinterpret_cast<const unsigned char*>(plain.data());
+	unsigned char *pEncrypted = reinterpret_cast<unsigned char*>(&encrypted[0]);
+	unsigned char *pDecrypted = reinterpret_cast<unsigned char*>(&decrypted[0]);
+
+	_bench("RSA encrypt pub", plain.size(), [&]()
+	{
+		for (size_t i = 0; i < BLOCKS; i++)
+		{
+			_sink += RSA_public_encrypt(szRSAPvt, pPlain + i * szRSAPvt, pEncrypted + i * szRSAPub, pRSA, RSA_PKCS1_PADDING);
+		}
+	});
+
+	_bench("RSA decrypt pvt", plain.size(), [&]()
+	{
+		for (size_t i = 0; i < BLOCKS; i++)
+		{
+			_sink += RSA_private_decrypt(szRSAPub, pEncrypted + i * szRSAPub, pDecrypted + i * szRSAPvt, pRSA, RSA_PKCS1_PADDING);
+		}
+	});
+
+	BN_free(pBN);
+	RSA_free(pRSA);
+
+	return 0;
+};
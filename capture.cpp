@@ -0,0 +1,403 @@
+#include "capture.h"
+#include <cstring>
+#include <cmath>
+
+#include "clock.h"
+#include "packet.h"
+
+using namespace std;
+using namespace RN;
+
+const uint32_t Capture::_SHB = 0x0a0d0d0a;
+const uint32_t Capture::_IDB = 0x00000001;
+const uint32_t Capture::_EPB = 0x00000006;
+const uint32_t Capture::_magic = 0x1a2b3c4d;
+const uint16_t Capture::_linkType = 147;
+const size_t Capture::_szBlockMax = 65536;
+
+// option codes
+static const uint16_t OPTEND = 0;
+static const uint16_t OPTCOMMENT = 1;
+static const uint16_t OPTSHBUSERAPPL = 4;
+static const uint16_t OPTIFNAME = 2;
+static const uint16_t OPTIFTSRESOL = 9;
+static const uint16_t OPTEPBFLAGS = 2;
+
+// direction bits of epb_flags
+static const uint32_t EPBINBOUND = 1;
+static const uint32_t EPBOUTBOUND = 2;
+
+Capture::Capture() :
+	_pFile(NULL),
+	_write(false),
+	_tsUnit(1.0)
+{
+}
+
+Capture::~Capture()
+{
+	Close();
+}
+
+bool Capture::Create(const char *pFile)
+{
+	Close();
+
+	_pFile = fopen(pFile, "wb");
+	if (!_pFile)
+	{
+		return false;
+	}
+
+	_write = true;
+
+	// section of unknown length
+
+	string opts;
+	_option(&opts, OPTSHBUSERAPPL, "rn2483", 6);
+	_option(&opts, OPTEND, NULL, 0);
+
+	char shb[16];
+	uint16_t major = 1;
+	uint16_t minor = 0;
+	int64_t length = -1;
+	memcpy(shb, &_magic, 4);
+	memcpy(shb + 4, &major, 2);
+	memcpy(shb + 6, &minor, 2);
+	memcpy(shb + 8, &length, 8);
+
+	bool okSHB = _block(_SHB, shb, sizeof(shb), NULL, 0, opts.data(), opts.size());
+
+	// interface of radio with microsecond time stamps (snap length is not limited)
+
+	opts.clear();
+	unsigned char tsresol = 6;
+	_option(&opts, OPTIFNAME, "rn2483", 6);
+	_option(&opts, OPTIFTSRESOL, &tsresol, 1);
+	_option(&opts, OPTEND, NULL, 0);
+
+	char idb[8];
+	uint16_t reserved = 0;
+	uint32_t snapLen = 0;
+	memcpy(idb, &_linkType, 2);
+	memcpy(idb + 2, &reserved, 2);
+	memcpy(idb + 4, &snapLen, 4);
+
+	bool okIDB = okSHB && _block(_IDB, idb, sizeof(idb), NULL, 0, opts.data(), opts.size());
+	if (!okIDB)
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+bool Capture::Open(const char *pFile)
+{
+	Close();
+
+	_pFile = fopen(pFile, "rb");
+	if (!_pFile)
+	{
+		return false;
+	}
+
+	_write = false;
+	_tsUnit = 1.0;
+
+	// file must start with section header, it is read again by Read
+
+	uint32_t type;
+	bool okType = fread(&type, 4, 1, _pFile) == 1 && type == _SHB && fseek(_pFile, 0, SEEK_SET) == 0;
+	if (!okType)
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+bool Capture::Close()
+{
+	if (!_pFile)
+	{
+		return true;
+	}
+
+	bool okWrite = !_write || !ferror(_pFile);
+	bool okClose = fclose(_pFile) == 0;
+	_pFile = NULL;
+
+	return okWrite && okClose;
+}
+
+bool Capture::IsOpen()
+{
+	return _pFile;
+}
+
+bool Capture::Write(bool tx, const void *ptr1, size_t sz1, const void *ptr2, size_t sz2)
+{
+	if (!_pFile || !_write)
+	{
+		return false;
+	}
+
+	uint64_t ts = static_cast<uint64_t>(Clock::Total());
+	uint32_t sz = static_cast<uint32_t>(sz1 + sz2);
+
+	char epb[20];
+	uint32_t ifId = 0;
+	uint32_t tsHigh = static_cast<uint32_t>(ts >> 32);
+	uint32_t tsLow = static_cast<uint32_t>(ts);
+	memcpy(epb, &ifId, 4);
+	memcpy(epb + 4, &tsHigh, 4);
+	memcpy(epb + 8, &tsLow, 4);
+	memcpy(epb + 12, &sz, 4);
+	memcpy(epb + 16, &sz, 4);
+
+	// frame of two segments is joined in block buffer, header is decoded from joined frame
+
+	char frame[512];
+	const char *pFrame = static_cast<const char*>(ptr1);
+	if (ptr2 && sz2)
+	{
+		if (sz > sizeof(frame))
+		{
+			return false;
+		}
+
+		memcpy(frame, ptr1, sz1);
+		memcpy(frame + sz1, ptr2, sz2);
+		pFrame = frame;
+	}
+
+	char comment[256];
+	Describe(pFrame, sz, comment, sizeof(comment));
+
+	uint32_t flags = tx ? EPBOUTBOUND : EPBINBOUND;
+	char opts[sizeof(comment) + 16];
+	size_t szComment = strlen(comment);
+	size_t szOpts = 0;
+
+	uint16_t code = OPTCOMMENT;
+	uint16_t len = static_cast<uint16_t>(szComment);
+	memcpy(opts, &code, 2);
+	memcpy(opts + 2, &len, 2);
+	memcpy(opts + 4, comment, szComment);
+	szOpts = 4 + szComment;
+	while (szOpts % 4)
+	{
+		opts[szOpts++] = 0;
+	}
+
+	code = OPTEPBFLAGS;
+	len = 4;
+	memcpy(opts + szOpts, &code, 2);
+	memcpy(opts + szOpts + 2, &len, 2);
+	memcpy(opts + szOpts + 4, &flags, 4);
+	memset(opts + szOpts + 8, 0, 4);
+	szOpts += 12;
+
+	return _block(_EPB, epb, sizeof(epb), pFrame, sz, opts, szOpts);
+}
+
+bool Capture::Read(bool *pTX, double *pTime, string *pFrame)
+{
+	if (!_pFile || _write)
+	{
+		return false;
+	}
+
+	for (;;)
+	{
+		uint32_t head[2];
+		if (fread(head, 4, 2, _pFile) != 2)
+		{
+			return false;
+		}
+
+		uint32_t type = head[0];
+		uint32_t len = head[1];
+		if (len < 12 || len % 4 || len > _szBlockMax)
+		{
+			return false;
+		}
+
+		_buf.resize(len - 8);
+		if (fread(&_buf[0], 1, _buf.size(), _pFile) != _buf.size())
+		{
+			return false;
+		}
+
+		const char *pBody = _buf.data();
+		size_t szBody = _buf.size() - 4;
+
+		if (type == _SHB)
+		{
+			// sections written on big endian machines are not supported
+
+			uint32_t magic;
+			memcpy(&magic, pBody, 4);
+			if (szBody < 16 || magic != _magic)
+			{
+				return false;
+			}
+
+			_tsUnit = 1.0;
+			continue;
+		}
+
+		if (type == _IDB)
+		{
+			uint16_t linkType;
+			memcpy(&linkType, pBody, 2);
+			if (szBody < 8 || linkType != _linkType)
+			{
+				return false;
+			}
+
+			// time stamp resolution is power of 10 (or 2 if highest bit is set)
+
+			for (size_t pos = 8; pos + 4 <= szBody; )
+			{
+				uint16_t code, szOpt;
+				memcpy(&code, pBody + pos, 2);
+				memcpy(&szOpt, pBody + pos + 2, 2);
+				if (code == OPTEND)
+				{
+					break;
+				}
+
+				if (code == OPTIFTSRESOL && szOpt == 1 && pos + 5 <= szBody)
+				{
+					unsigned char tsresol = pBody[pos + 4];
+					double tick = tsresol & 0x80 ? pow(2.0, -(tsresol & 0x7f)) : pow(10.0, -tsresol);
+					_tsUnit = tick * 1e6;
+				}
+
+				pos += 4 + (szOpt + 3) / 4 * 4;
+			}
+
+			continue;
+		}
+
+		if (type != _EPB || szBody < 20)
+		{
+			continue;
+		}
+
+		uint32_t tsHigh, tsLow, szCap;
+		memcpy(&tsHigh, pBody + 4, 4);
+		memcpy(&tsLow, pBody + 8, 4);
+		memcpy(&szCap, pBody + 12, 4);
+		if (20 + szCap > szBody)
+		{
+			return false;
+		}
+
+		// frames without direction are taken as received
+
+		*pTX = false;
+		for (size_t pos = 20 + (szCap + 3) / 4 * 4; pos + 4 <= szBody; )
+		{
+			uint16_t code, szOpt;
+			memcpy(&code, pBody + pos, 2);
+			memcpy(&szOpt, pBody + pos + 2, 2);
+			if (code == OPTEND)
+			{
+				break;
+			}
+
+			if (code == OPTEPBFLAGS && szOpt == 4 && pos + 8 <= szBody)
+			{
+				uint32_t flags;
+				memcpy(&flags, pBody + pos + 4, 4);
+				*pTX = (flags & 3) == EPBOUTBOUND;
+			}
+
+			pos += 4 + (szOpt + 3) / 4 * 4;
+		}
+
+		*pTime = static_cast<double>((static_cast<uint64_t>(tsHigh) << 32) | tsLow) * _tsUnit;
+		pFrame->assign(pBody + 20, szCap);
+
+		return true;
+	}
+}
+
+void Capture::Describe(const char *pFrame, size_t sz, char *pText, size_t szText)
+{
+	PacketType type;
+	bool okType = GetPacketType(pFrame, sz, &type);
+
+	PacketInfoInit init;
+	PacketInfoPart part;
+	PacketInfoRsp rsp;
+	PacketInfoRspWin rspWin;
+
+	if (okType && type == PTINIT && DecodeInit(pFrame, sz, &init))
+	{
+		snprintf(pText, szText,
+			"init session(%u) local(%u) remote(%u) port(%u) ack(%i) compress(%i) stream(%i) window(%u) size(%u/%zu) poll(%i) end(%i)",
+			init.Session, init.LocalId, init.RemoteId, init.Port, init.Ack, init.Compress, init.Stream, init.Window,
+			init.Size, init.SizeTotal, init.Poll, init.End);
+	}
+	else if (okType && type == PTPART && DecodePart(pFrame, sz, &part))
+	{
+		snprintf(pText, szText, "part session(%u) seg(%u) size(%u) poll(%i) end(%i)",
+			part.Session, part.SegId, part.Size, part.Poll, part.End);
+	}
+	else if (okType && type == PTRSP && DecodeRsp(pFrame, sz, &rsp))
+	{
+		snprintf(pText, szText, "rsp session(%u) seg(%u) resend(%i)", rsp.Session, rsp.SegId, rsp.RequestResend);
+	}
+	else if (okType && type == PTRSPWIN && DecodeRspWin(pFrame, sz, &rspWin))
+	{
+		snprintf(pText, szText, "rspwin session(%u) seg(%u) mask(%08x)", rspWin.Session, rspWin.SegId, rspWin.Mask);
+	}
+	else
+	{
+		snprintf(pText, szText, "unknown size(%zu)", sz);
+	}
+}
+
+bool Capture::_block(uint32_t type, const void *pBody, size_t szBody, const void *pData, size_t szData,
+	const void *pOpts, size_t szOpts)
+{
+	size_t szPad = (szData + 3) / 4 * 4;
+	uint32_t len = static_cast<uint32_t>(12 + szBody + szPad + szOpts);
+
+	_buf.resize(len);
+	char *ptr = &_buf[0];
+	memcpy(ptr, &type, 4);
+	memcpy(ptr + 4, &len, 4);
+	memcpy(ptr + 8, pBody, szBody);
+	ptr += 8 + szBody;
+	if (szData)
+	{
+		memcpy(ptr, pData, szData);
+	}
+	memset(ptr + szData, 0, szPad - szData);
+	ptr += szPad;
+	memcpy(ptr, pOpts, szOpts);
+	memcpy(ptr + szOpts, &len, 4);
+
+	// block is flushed, so capture of crashed node is complete up to its last frame
+
+	return fwrite(_buf.data(), 1, len, _pFile) == len && fflush(_pFile) == 0;
+}
+
+void Capture::_option(string *pOpts, uint16_t code, const void *ptr, size_t sz)
+{
+	uint16_t len = static_cast<uint16_t>(sz);
+	pOpts->append(reinterpret_cast<const char*>(&code), 2);
+	pOpts->append(reinterpret_cast<const char*>(&len), 2);
+	if (sz)
+	{
+		pOpts->append(static_cast<const char*>(ptr), sz);
+	}
+	pOpts->append((4 - sz % 4) % 4, '\0');
+}
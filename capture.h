@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+using namespace std;
+
+namespace RN
+{
+	// Frames on air recorded in pcap-ng file, so traffic of field can be inspected in Wireshark and
+	// replayed on desk. Each frame is stored in Enhanced Packet Block with time when it is completely
+	// on air (radio_tx_ok or radio_rx line) [microsecond since epoch], direction flag and comment with
+	// decoded packet info. Payload of link type LINKTYPE_USER0 (147) is frame as sent by radio (packet
+	// info, data and FEC parity). Only little endian sections with one interface are read.
+	class Capture
+	{
+		public:
+			// Default class constructor.
+			Capture();
+
+			// Class destructor, closes file.
+			~Capture();
+
+			// Create file and write section and interface headers, frames are written by Write.
+			// pFile: Path of capture file.
+			// Returns true on success, false on failure.
+			bool Create(const char *pFile);
+
+			// Open existing file for reading, frames are read by Read.
+			// pFile: Path of capture file.
+			// Returns true on success, false on failure.
+			bool Open(const char *pFile);
+
+			// Close file.
+			// Returns true on success, false if written data could not be stored.
+			bool Close();
+
+			// Capture file is open.
+			// Returns true if file is open.
+			bool IsOpen();
+
+			// Write frame (nothing is written if file is not created).
+			// tx: Frame is sent by this node (received otherwise).
+			// ptr1: Pointer to first segment of frame.
+			// sz1: Size of first segment [byte].
+			// ptr2: Pointer to second segment of frame or NULL.
+			// sz2: Size of second segment [byte].
+			// Returns true on success, false on failure.
+			bool Write(bool tx, const void *ptr1, size_t sz1, const void *ptr2 = NULL, size_t sz2 = 0);
+
+			// Read next frame, blocks of other types are skipped.
+			// pTX: Pointer where direction will be stored (true if frame was sent by capturing node).
+			// pTime: Pointer where time of frame will be stored [microsecond since epoch].
+			// pFrame: Pointer where frame will be stored.
+			// Returns true on success, false at end of file or on failure.
+			bool Read(bool *pTX, double *pTime, string *pFrame);
+
+			// Describe packet info of frame in text (used in comments of frames).
+			// pFrame: Pointer to frame.
+			// sz: Size of frame [byte].
+			// pText: Pointer to buffer where null-terminated text will be stored.
+			// szText: Size of buffer pText [byte].
+			static void Describe(const char *pFrame, size_t sz, char *pText, size_t szText);
+
+		private:
+			// Write block with options padded to 4 bytes and trailing total length.
+			// type: Block type.
+			// pBody: Pointer to fixed part of block (after type and length).
+			// szBody: Size of fixed part [byte], multiple of 4.
+			// pData: Pointer to variable data (padded) or NULL.
+			// szData: Size of variable data [byte].
+			// pOpts: Pointer to encoded options including end of options.
+			// szOpts: Size of options [byte], multiple of 4.
+			// Returns true on success, false on failure.
+			bool _block(uint32_t type, const void *pBody, size_t szBody, const void *pData, size_t szData,
+				const void *pOpts, size_t szOpts);
+
+			// Append option padded to 4 bytes.
+			// pOpts: Options where option will be appended.
+			// code: Option code.
+			// ptr: Pointer to value.
+			// sz: Size of value [byte].
+			static void _option(string *pOpts, uint16_t code, const void *ptr, size_t sz);
+
+			static const uint32_t _SHB;		// Section Header Block type.
+			static const uint32_t _IDB;		// Interface Description Block type.
+			static const uint32_t _EPB;		// Enhanced Packet Block type.
+			static const uint32_t _magic;		// Byte-order magic of section.
+			static const uint16_t _linkType;	// LINKTYPE_USER0.
+			static const size_t _szBlockMax;	// Largest block which is read [byte].
+
+			FILE *_pFile;		// Open capture file or NULL.
+			bool _write;		// File is created for writing.
+			double _tsUnit;		// Time stamp unit of read interface [microsecond].
+			string _buf;		// Buffer of block (reused so frames do not allocate).
+	};
+};
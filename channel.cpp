@@ -0,0 +1,120 @@
+#include "channel.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+using namespace RN;
+
+Channel::Channel() :
+	_uni(0.0, 1.0),
+	_bad(false),
+	_frames(0),
+	_lost(0),
+	_corrupt(0),
+	_err(0),
+	_bits(0)
+{
+	memset(&_param, 0, sizeof(_param));
+	_param.LossBad = 1.0;
+	_param.BadToGood = 1.0;
+}
+
+bool Channel::SetParam(const ChannelParam *pParam)
+{
+	const double *pProb[] = { &pParam->Loss, &pParam->LossBad, &pParam->GoodToBad, &pParam->BadToGood, &pParam->BitError, &pParam->RadioErr };
+	for (size_t i = 0; i < sizeof(pProb) / sizeof(pProb[0]); i++)
+	{
+		if (!(*pProb[i] >= 0.0 && *pProb[i] <= 1.0))
+		{
+			return false;
+		}
+	}
+
+	if (pParam->Latency < 0.0)
+	{
+		return false;
+	}
+
+	_param = *pParam;
+	_gen.seed(_param.Seed);
+	_uni.reset();
+	_bad = false;
+
+	return true;
+}
+
+ChannelFate Channel::Pass(string *pFrame)
+{
+	_frames++;
+
+	// loss depends on state of channel, state changes after each frame
+
+	bool lost = _chance(_bad ? _param.LossBad : _param.Loss);
+	_bad = _chance(_bad ? 1.0 - _param.BadToGood : _param.GoodToBad);
+
+	if (lost)
+	{
+		_lost++;
+		return CFLOST;
+	}
+
+	if (_chance(_param.RadioErr))
+	{
+		_err++;
+		return CFERR;
+	}
+
+	if (_param.BitError <= 0.0)
+	{
+		return CFOK;
+	}
+
+	// flip bits with geometric distance between errors
+
+	size_t bits = pFrame->size() * 8;
+	size_t flipped = 0;
+	double lnOk = log(1.0 - _param.BitError);
+	for (size_t bit = 0; ; bit++)
+	{
+		if (_param.BitError < 1.0)
+		{
+			bit += static_cast<size_t>(floor(log(1.0 - _uni(_gen)) / lnOk));
+		}
+
+		if (bit >= bits)
+		{
+			break;
+		}
+
+		(*pFrame)[bit / 8] ^= 1 << (bit % 8);
+		flipped++;
+	}
+
+	if (!flipped)
+	{
+		return CFOK;
+	}
+
+	_corrupt++;
+	_bits += flipped;
+
+	return CFCORRUPT;
+}
+
+double Channel::GetLatency()
+{
+	return _param.Latency;
+}
+
+void Channel::PrintStats(const char *pName)
+{
+	printf(	"%s frames(%lu), lost(%lu), corrupt(%lu), bits(%lu), err(%lu)\n",
+		pName, _frames, _lost, _corrupt, _bits, _err);
+}
+
+bool Channel::_chance(double p)
+{
+	// random number is drawn even for 0 and 1 so sequence does not depend on parameters
+
+	return _uni(_gen) < p;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <string>
+#include <random>
+
+using namespace std;
+
+namespace RN
+{
+	// Parameters of channel impairment model.
+	struct ChannelParam
+	{
+		unsigned int Seed;		// Seed of random generator (same seed gives same sequence of impairments).
+		double Loss;			// Probability of frame loss in good state.
+		double LossBad;			// Probability of frame loss in bad state.
+		double GoodToBad;		// Probability of transition from good to bad state after frame (0 for i.i.d. loss).
+		double BadToGood;		// Probability of transition from bad to good state after frame.
+		double BitError;		// Probability of bit error in received frame.
+		double RadioErr;		// Probability that heard frame ends with radio_err on receiving device.
+		double Latency;			// Extra latency of frame delivery [second].
+	};
+
+	// Fate of frame which went through channel.
+	enum ChannelFate : unsigned char
+	{
+		CFOK,		// Frame is received without errors.
+		CFLOST,		// Frame is lost (receiving device keeps listening).
+		CFCORRUPT,	// Frame is received with bit errors.
+		CFERR		// Receiving device reports radio_err.
+	};
+
+	// Seeded channel impairment model of one direction between emulated RN2483 devices.
+	// Frame loss follows Gilbert-Elliott model (i.i.d. loss if GoodToBad is 0).
+	class Channel
+	{
+		public:
+			// Default class constructor (channel without impairments).
+			Channel();
+
+			// Set parameters of channel and restart random generator.
+			// pParam: Pointer to channel parameters.
+			// Returns true on success, false if any probability is out of range.
+			bool SetParam(const ChannelParam *pParam);
+
+			// Pass frame through channel.
+			// pFrame: Pointer to frame which can be corrupted.
+			// Returns fate of frame.
+			ChannelFate Pass(string *pFrame);
+
+			// Extra latency of frame delivery [second].
+			double GetLatency();
+
+			// Print statistics of channel.
+			// pName: Pointer to name of channel.
+			void PrintStats(const char *pName);
+
+		private:
+			// Random event with given probability.
+			// p: Probability of event.
+			// Returns true if event occured.
+			bool _chance(double p);
+
+			ChannelParam _param;		// Parameters of channel.
+			mt19937 _gen;			// Random generator.
+			uniform_real_distribution<double> _uni;	// Uniform distribution in interval [0, 1).
+			bool _bad;			// Channel is in bad state.
+
+			unsigned long _frames;		// Number of frames.
+			unsigned long _lost;		// Number of lost frames.
+			unsigned long _corrupt;		// Number of corrupted frames.
+			unsigned long _err;		// Number of radio_err.
+			unsigned long _bits;		// Number of flipped bits.
+	};
+};
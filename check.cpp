@@ -0,0 +1,335 @@
+#include <vector>
+#include <string>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <cstdio>
+#include <unistd.h>
+#include <openssl/rsa.h>
+#include <openssl/pem.h>
+#include <openssl/bn.h>
+
+#include "capture.h"
+#include "comm.h"
+#include "emu.h"
+#include "packet.h"
+#include "log.h"
+
+#define WHITE "\033[0m"
+#define RED "\033[1;31m"
+#define GREEN "\033[1;32m"
+
+using namespace std;
+using namespace RN;
+
+// Checks of Comm on emulated link, both nodes and link run in this process and each check gets
+// fresh link. Exit code is number of failed checks.
+
+// Check which is run on devices of emulated link.
+// pDev0: Device of receiving node.
+// pDev1: Device of sending node.
+// Returns true if check passed.
+typedef bool (*CheckFn)(const char *pDev0, const char *pDev1);
+
+// Named check.
+struct Check
+{
+	const char *Name;		// Name of check.
+	CheckFn Fn;			// Function of check.
+};
+
+bool run_check(const Check &check);
+bool init_node(Comm *pComm, const char *pDevice, bool tx, unsigned int rate);
+bool make_keys(const string &pub, const string &pvt);
+bool check_parts_noack(const char *pDev0, const char *pDev1);
+bool check_sym_replay(const char *pDev0, const char *pDev1);
+bool sym_replay(const string &dir, const char *pDev0, const char *pDev1);
+
+int main()
+{
+	static const Check checks[] =
+	{
+		{"multi-part messages without ack", check_parts_noack},
+		{"replayed session key after refresh", check_sym_replay},
+	};
+
+	Log::Start();
+
+	int failed = 0;
+	for (const Check &check : checks)
+	{
+		failed += !run_check(check);
+	}
+
+	Log::Stop();
+
+	cout << (failed ? RED "[FAIL]" WHITE : GREEN "[PASS]" WHITE) << " " << failed << " of "
+		<< sizeof(checks) / sizeof(checks[0]) << " checks failed\n";
+
+	return failed;
+}
+
+bool run_check(const Check &check)
+{
+	EmuLink link;
+	bool okLink = link.Init(NULL, NULL);
+	if (!okLink)
+	{
+		cout << RED "[FAIL]" WHITE " " << check.Name << ": unable to open pseudo-terminals\n";
+		return false;
+	}
+
+	volatile bool stop = false;
+	thread threadLink([&link, &stop]() { link.Run(&stop); });
+
+	bool okCheck = check.Fn(link.GetDevice(0)->GetDevice(), link.GetDevice(1)->GetDevice());
+
+	stop = true;
+	threadLink.join();
+
+	LOG_RESULT(okCheck, "CHECK %s", check.Name);
+	return okCheck;
+}
+
+bool init_node(Comm *pComm, const char *pDevice, bool tx, unsigned int rate)
+{
+	PacketInfo info;
+	info.LocalId = tx ? 21 : 20;
+	info.RemoteId = tx ? 20 : 21;
+	info.Port = 10;
+
+	return	pComm->Init(pDevice) &&
+		pComm->SetInfo(&info) &&
+		pComm->SetBitRate(rate);
+}
+
+bool make_keys(const string &pub, const string &pvt)
+{
+	RSA *pRSA = RSA_new();
+	BIGNUM *pExp = BN_new();
+	FILE *pPub = fopen(pub.data(), "w");
+	FILE *pPvt = fopen(pvt.data(), "w");
+
+	bool okKeys =
+		pRSA && pExp && pPub && pPvt &&
+		BN_set_word(pExp, RSA_F4) == 1 &&
+		RSA_generate_key_ex(pRSA, 2048, pExp, NULL) == 1 &&
+		PEM_write_RSAPublicKey(pPub, pRSA) == 1 &&
+		PEM_write_RSAPrivateKey(pPvt, pRSA, NULL, NULL, 0, NULL, NULL) == 1;
+
+	if (pPub)
+	{
+		okKeys = fclose(pPub) == 0 && okKeys;
+	}
+	if (pPvt)
+	{
+		okKeys = fclose(pPvt) == 0 && okKeys;
+	}
+	BN_free(pExp);
+	RSA_free(pRSA);
+
+	return okKeys;
+}
+
+bool check_parts_noack(const char *pDev0, const char *pDev1)
+{
+	// parts follow each other (and init packet of next message follows last part) without response,
+	// receiving node must be listening again before each of them is on air
+
+	static const unsigned int messages = 5;
+	static const size_t size = 600;
+
+	Comm tx;
+	Comm rx;
+	bool okInit = init_node(&rx, pDev0, false, 20000) && init_node(&tx, pDev1, true, 20000);
+	if (!okInit)
+	{
+		return false;
+	}
+
+	atomic<bool> sendEnd(false);
+	unsigned int delivered = 0;
+	thread receiver([&]()
+	{
+		vector<char> buf(rx.GetMaxSz());
+		while (delivered < messages)
+		{
+			size_t szRX = 0;
+			bool okRX = rx.Receive(buf.data(), buf.size(), &szRX);
+			if (!okRX)
+			{
+				if (sendEnd)
+				{
+					break;
+				}
+				continue;
+			}
+
+			bool okMsg = szRX == size;
+			for (size_t i = 0; okMsg && i < size; i++)
+			{
+				okMsg = buf[i] == static_cast<char>(i * 151 + delivered);
+			}
+
+			if (!okMsg)
+			{
+				break;
+			}
+
+			delivered++;
+		}
+	});
+
+	vector<char> msg(size);
+	for (unsigned int m = 0; m < messages; m++)
+	{
+		for (size_t i = 0; i < size; i++)
+		{
+			msg[i] = static_cast<char>(i * 151 + m);
+		}
+
+		tx.Send(msg.data(), msg.size(), false);
+	}
+
+	sendEnd = true;
+	receiver.join();
+
+	return delivered == messages;
+}
+
+bool check_sym_replay(const char *pDev0, const char *pDev1)
+{
+	// keys and capture are kept in temporary directory
+
+	char dir[] = "/tmp/check-XXXXXX";
+	if (!mkdtemp(dir))
+	{
+		return false;
+	}
+
+	bool okCheck = sym_replay(dir, pDev0, pDev1);
+
+	unlink((string(dir) + "/key.pub").data());
+	unlink((string(dir) + "/key").data());
+	unlink((string(dir) + "/sym.pcapng").data());
+	rmdir(dir);
+
+	return okCheck;
+}
+
+bool sym_replay(const string &dir, const char *pDev0, const char *pDev1)
+{
+	// first message carries session key which is replaced by key of restarted sending node and by its
+	// refresh, frames of first message are recorded and sent again afterwards, receiving node must
+	// acknowledge them but reject older key (otherwise all messages sent with it could be replayed)
+
+	static const unsigned int messages = 17;
+
+	string pub = dir + "/key.pub";
+	string pvt = dir + "/key";
+	string cap = dir + "/sym.pcapng";
+	if (!make_keys(pub, pvt))
+	{
+		return false;
+	}
+
+	Comm rx;
+	bool okInit = init_node(&rx, pDev0, false, 20000) && rx.SetCrypt(pub.data(), pvt.data());
+	if (!okInit)
+	{
+		return false;
+	}
+
+	vector<char> msg(100);
+	vector<char> buf(rx.GetSzSymBuf());
+	for (unsigned int run = 0; run < 2; run++)
+	{
+		Comm tx;
+		okInit =
+			init_node(&tx, pDev1, true, 20000) &&
+			tx.SetCrypt(pub.data(), pvt.data()) &&
+			(run || tx.SetCapture(cap.data()));
+		if (!okInit)
+		{
+			return false;
+		}
+
+		unsigned int count = run ? messages : 1;
+		unsigned int delivered = 0;
+		thread receiver([&]()
+		{
+			for (unsigned int m = 0; m < count; m++)
+			{
+				delivered += rx.ReceiveDecryptSym(buf.data(), buf.size());
+			}
+		});
+
+		for (unsigned int m = 0; m < count; m++)
+		{
+			msg[0] = static_cast<char>(m);
+			tx.EncryptSymSend(msg.data(), msg.size());
+		}
+
+		receiver.join();
+		tx.SetCapture(NULL);
+
+		if (delivered != count)
+		{
+			return false;
+		}
+	}
+
+	// frames of first message are those sent with session of first init packet
+
+	Capture capture;
+	if (!capture.Open(cap.data()))
+	{
+		return false;
+	}
+
+	vector<string> frames;
+	bool tx;
+	double time;
+	string frame;
+	PacketInfoInit init;
+	PacketInfoPart part;
+	while (capture.Read(&tx, &time, &frame))
+	{
+		PacketType type;
+		if (!tx || !GetPacketType(frame.data(), frame.size(), &type))
+		{
+			continue;
+		}
+
+		if (type == PTINIT && DecodeInit(frame.data(), frame.size(), &init))
+		{
+			if (!frames.empty())
+			{
+				break;
+			}
+			frames.push_back(frame);
+		}
+		else if (type == PTPART && !frames.empty() && DecodePart(frame.data(), frame.size(), &part) && part.Session == init.Session)
+		{
+			frames.push_back(frame);
+		}
+	}
+
+	// each frame is acknowledged, so whole message is received before it is decrypted
+
+	bool okDecrypt = true;
+	thread receiver([&]() { okDecrypt = rx.ReceiveDecryptSym(buf.data(), buf.size()); });
+
+	RN2483 player;
+	bool okReplay = player.Init(pDev1) && player.SetBitRate(20000);
+	for (size_t i = 0; okReplay && i < frames.size(); i++)
+	{
+		char rsp[64];
+		okReplay = player.TX(frames[i].data(), frames[i].size()) && player.RX(rsp, sizeof(rsp), 2.0) > 0;
+	}
+
+	receiver.join();
+
+	return okReplay && !okDecrypt;
+}
@@ -1,34 +1,42 @@
 #include "comm.h"
+#include "trace.h"
+#include "log.h"
+#include <cmath>
 
 using namespace RN;
 
-#define WHITE "\033[0m"
-#define RED "\033[1;31m"
-#define GREEN "\033[1;32m"
-#define BROWN "\033[1;33m"
-
-#define _DEBUG
-
-#ifdef _DEBUG
-#define _DEBUG_CRYPT
-#define _DEBUG_COMM_SR
-#define _DEBUG_COMM_TR
-#endif
-
 const size_t Comm::_szBufTX = 63;
 const size_t Comm::_szBufRX = 63;
-const char Comm::_retrySend = 1;
+const unsigned char Comm::_retrySendMax = 16;
 const char Comm::_retryTX = 1;
 const char Comm::_retryTXAck = 1;
-const double Comm::_toRecv = 2.0;
-const double Comm::_toAck = 2.0;
+const unsigned char Comm::_windowMax = 32;
+const double Comm::_toProc = 0.05;
+const double Comm::_toWDTStep = 0.05;
+const double Comm::_toGapWin = 0.005;
+const double Comm::_tByteUART = 2 * 10 / 57600.0;
+const size_t Comm::_szSymKey = 32;
+const size_t Comm::_szSymTag = 8;
+const size_t Comm::_szSymInfo = 5;
+const size_t Comm::_szSymEpoch = 8;
+const unsigned char Comm::_symFKey = 0x01;
+const unsigned int Comm::_symKeyRefresh = 16;
 
 Comm::Comm() :
-	_bPckInfoSet(false),
-	_szDataMaxInit(_szBufTX - sizeof(_TXInit)),
-	_szDataMaxPart(_szBufTX - sizeof(_TXPart)),
-	_szDataMax(_szDataMaxInit + _szDataMaxPart * 253), // maximum number of packet segments (unsigned int = 256) - two last empty packet which are send to end communication
+	_retrySend(4),
+	_window(1),
+	_session(static_cast<unsigned char>(static_cast<uint64_t>(Clock::Total()) & 0xff)),
+	_pTXBuf(new char[_szBufTX]),
+	_szDataMaxInit(_szBufTX - SZ_INFO_INIT_MAX),
+	_szDataMaxPart(_szBufTX - SZ_INFO_PART),
+	_szDataMax(_szDataMaxInit + _szDataMaxPart * 255), // maximum number of part packets (PacketInfoPart::SegId is unsigned char, 0 is init packet)
+	_pRTO(&_rto[0]),
+	_wdt(0),
+	_toInit(1.0),
+	_RXEnd(false),
+	_RXEndTime(0.0),
 	_pRXBuf(new char[_szBufRX]),
+	_bPckInfoSet(false),
 	_pPublic(NULL),
 	_pPrivate(NULL),
 	_pRSAPvt(NULL),
@@ -38,33 +46,96 @@ Comm::Comm() :
 	_szDecryptBuf(0),
 	_szEncryptBuf(0),
 	_szRSAPub(0),
-	_szRSAPvt(0)
+	_szRSAPvt(0),
+	_bCompress(false),
+	_pSymCtx(NULL),
+	_pSymBuf(NULL),
+	_szSymBuf(0),
+	_symCounterTX(0),
+	_symCounterRX(0),
+	_symEpochTX(0),
+	_symEpochRX(0),
+	_bSymKeySent(false),
+	_bSymKeyRecv(false)
 {
+	static_assert(SZ_INFO_INIT_MAX < _szBufTX, "init packet info does not fit into TX buffer");
+	static_assert(SZ_INFO_RSPWIN <= _szBufRX, "window response does not fit into RX buffer");
+	static_assert(_windowMax <= 32, "window does not fit into PacketInfoRspWin::Mask");
+	static_assert(_windowMax <= sizeof(_streamSz), "window does not fit into stream slots");
+	static_assert(_szSymKey == sizeof(_symKeyTX) && _szSymKey == sizeof(_symKeyRX), "invalid size of session key");
+
 	_pChk = new char[_szDataMax];
-	_pRXRsp = reinterpret_cast<PacketInfoRsp*>(_pRXBuf);
-	_pRXInit = reinterpret_cast<PacketInfoInit*>(_pRXBuf);
-	_pRXPart = reinterpret_cast<PacketInfoPart*>(_pRXBuf);
+	_pCompBuf = new char[_szDataMax];
+	_pStreamBuf = new char[_windowMax * _szBufTX];
+	_pRXRsp = &_RXHdrRsp;
+	_pRXRspWin = &_RXHdrRspWin;
+	_pRXInit = &_RXHdr;
+	_pRXPart = &_RXHdr;
 
 	memset(&_TXInit, 0, sizeof(_TXInit));
 	memset(&_TXPart, 0, sizeof(_TXPart));
 	memset(&_RXInfo, 0, sizeof(_RXInfo));
 	memset(&_RXRsp, 0, sizeof(_RXRsp));
+	memset(&_RXRspWin, 0, sizeof(_RXRspWin));
+	memset(&_RXHdr, 0, sizeof(_RXHdr));
+	memset(&_RXHdrRsp, 0, sizeof(_RXHdrRsp));
+	memset(&_RXHdrRspWin, 0, sizeof(_RXHdrRspWin));
+	memset(_symKeyTX, 0, sizeof(_symKeyTX));
+	memset(_symKeyRX, 0, sizeof(_symKeyRX));
+
+	// restarted node must not continue with session id of its previous run, clock is used only if
+	// random generator fails
+	RAND_bytes(&_session, 1);
 }
 
 Comm::~Comm()
 {
 	delete[] _pChk;
+	delete[] _pCompBuf;
+	delete[] _pStreamBuf;
+	delete[] _pTXBuf;
+	delete[] _pRXBuf;
 	_releaseCrypt();
 }
 
-bool Comm::Init()
+bool Comm::Init(const char *pDevice, bool warm)
 {
-	bool okInit = _rn.Init();
+	bool okInit = _rn.Init(pDevice, warm);
 	if (!okInit)
 	{
 		return false;
 	}
 
+	// timeouts follow radio settings and watch dog timeout set by device
+
+	Mod modulation;
+	unsigned int rate;
+	unsigned int prlen;
+	bool crc;
+	char sync[17];
+	bool okGet =
+		_rn.GetMod(&modulation) &&
+		_rn.GetBitRate(&rate) &&
+		_rn.GetPreambleLength(&prlen) &&
+		_rn.GetCRC(&crc) &&
+		_rn.GetSync(sync, sizeof(sync) - 1);
+	if (!okGet || !rate)
+	{
+		return false;
+	}
+
+	bool okWDT = _rn.GetWDT(&_wdt);
+	if (!okWDT)
+	{
+		return false;
+	}
+
+	_air.SetMod(modulation);
+	_air.SetPreambleLength(prlen);
+	_air.SetCRC(crc);
+	_air.SetSzSync(strlen(sync) / 2);
+	_setAirTime(rate);
+
 	return true;
 }
 
@@ -75,11 +146,14 @@ bool Comm::SetInfo(const PacketInfo *pInfo)
 		return false;
 	}
 
-	_RXRsp.LocalId = _RXInfo.LocalId = _TXPart.LocalId = _TXInit.LocalId = pInfo->LocalId;
-	_RXRsp.RemoteId = _RXInfo.RemoteId = _TXPart.RemoteId = _TXInit.RemoteId = pInfo->RemoteId;
-	_RXRsp.Port = _RXInfo.Port = _TXPart.Port = _TXInit.Port = pInfo->Port;
+	_RXRspWin.LocalId = _RXRsp.LocalId = _RXInfo.LocalId = _TXPart.LocalId = _TXInit.LocalId = pInfo->LocalId;
+	_RXRspWin.RemoteId = _RXRsp.RemoteId = _RXInfo.RemoteId = _TXPart.RemoteId = _TXInit.RemoteId = pInfo->RemoteId;
+	_RXRspWin.Port = _RXRsp.Port = _RXInfo.Port = _TXPart.Port = _TXInit.Port = pInfo->Port;
 	_bPckInfoSet = true;
 
+	_pRTO = &_rto[pInfo->RemoteId];
+	_pRTO->SetInit(_toInit);
+
 	return true;
 }
 
@@ -127,44 +201,160 @@ bool Comm::SetCrypt(const char *pPublic, const char *pPrivate)
 		return false;
 	}
 
+	// message with session key encryption must fit encrypted session key (always sent with first message)
+
+	if (_szDataMax <= _szSymInfo + _szRSAPub + _szSymTag)
+	{
+		return false;
+	}
+
+	_szSymBuf = _szDataMax - _szSymInfo - _szRSAPub - _szSymTag;
+	_pSymBuf = new unsigned char[_szDataMax];
+	_pSymCtx = EVP_CIPHER_CTX_new();
+
+	if (!(_pSymBuf && _pSymCtx))
+	{
+		return false;
+	}
+
+	// session key is generated when it is attached to first message
+
+	_symCounterTX = 0;
+	_symEpochRX = 0;
+	_bSymKeySent = false;
+	_bSymKeyRecv = false;
+
+	return true;
+}
+
+bool Comm::SetFEC(unsigned char parity)
+{
+	// init packet with largest packet info must carry at least one byte of data
+
+	if (SZ_INFO_INIT_MAX + parity >= _szBufTX)
+	{
+		return false;
+	}
+
+	bool okParity = _fec.SetParity(parity);
+	if (!okParity)
+	{
+		return false;
+	}
+
+	_szDataMaxInit = _szBufTX - SZ_INFO_INIT_MAX - parity;
+	_szDataMaxPart = _szBufTX - SZ_INFO_PART - parity;
+	_szDataMax = _szDataMaxInit + _szDataMaxPart * 255;
+
+	return true;
+}
+
+bool Comm::SetCompress(bool state)
+{
+	_bCompress = state;
+
+	return true;
+}
+
+bool Comm::SetWindow(unsigned char window)
+{
+	if (!window || window > _windowMax)
+	{
+		return false;
+	}
+
+	_window = window;
+
+	return true;
+}
+
+bool Comm::SetRetry(unsigned char retry)
+{
+	if (retry > _retrySendMax)
+	{
+		return false;
+	}
+
+	_retrySend = retry;
+
+	return true;
+}
+
+bool Comm::SetBitRate(unsigned int rate)
+{
+	if (!rate)
+	{
+		return false;
+	}
+
+	bool okRate = _rn.SetBitRate(rate);
+	if (!okRate)
+	{
+		return false;
+	}
+
+	_setAirTime(rate);
+
 	return true;
 }
 
 bool Comm::Send(const void *pData, size_t szData, bool ack)
+{
+	// send compressed data only if it saves space
+
+	size_t szComp = _compress(pData, szData);
+	if (szComp)
+	{
+		return _sendMsg(_pCompBuf, szComp, ack, true);
+	}
+
+	return _sendMsg(pData, szData, ack, false);
+}
+
+bool Comm::_sendMsg(const void *pData, size_t szData, bool ack, bool compress)
 {
 	// check if data size is small enough to fit into TX buffer
 	
 	if (szData > _szDataMax)
 	{
-#ifdef _DEBUG_COMM_SR
-		printf(RED "[ERROR]" WHITE " SEND size(%u), ack(%i)\n", szData, ack);
-#endif
+		LOG_ERROR("SEND size(%u), ack(%i)", szData, ack);
 		return false;
 	}
 
-#ifdef _DEBUG_COMM_SR
-	printf(GREEN "[OK]" WHITE " SEND START size(%u), ack(%i)\n", szData, ack);
-#endif
+	LOG_OK("SEND START size(%u), ack(%i)", szData, ack);
 
+	Clock clk;
 	const char *ptr = static_cast<const char*>(pData);
 
+	// init packet may follow last packet of previous message sent without ack
+
+	if (!_TXInit.Ack)
+	{
+		_waitGap(0, 0);
+	}
+
 	// set init packet info
 
+	_TXInit.Session = _TXPart.Session = ++_session;
 	_TXInit.Ack = ack;
+	_TXInit.Compress = compress;
+	_TXInit.Stream = false;
+	_TXInit.Window = ack ? _window : 1;
 	_TXInit.SizeTotal = szData;
-	_TXInit.Size = szData < _szDataMaxInit ? szData : _szDataMaxInit;
+
+	size_t szDataInit = _szBufTX - GetSzInfoInit(&_TXInit) - _fec.GetParity();
+	_TXInit.Size = szData < szDataInit ? szData : szDataInit;
+	_TXInit.End = _TXInit.Size == szData;
 
 	// send init packet
 
-	bool okTX = _send(&_TXInit, sizeof(_TXInit), ptr);
+	bool okTX = _send(&_TXInit, ptr);
 
 	if (!okTX)
 	{
 		// if not TX is not successfull raise error
 
-#ifdef _DEBUG_COMM_SR
-		printf(RED "[ERROR]" WHITE " SEND END size(0/%u), ack(%i)\n", szData, ack);
-#endif
+		LOG_ERROR("SEND END size(0/%u), ack(%i)", szData, ack);
 		return false;
 	}
 
@@ -172,21 +362,46 @@ bool Comm::Send(const void *pData, size_t szData, bool ack)
 	ptr += _TXInit.Size;
 
 	_TXPart.SegId = 0;
+	_TXPart.Poll = false;
+	_TXPart.End = false;
+
+	// send part packets in windows if requested
+
+	if (_TXInit.Window > 1 && left)
+	{
+		okTX = _sendWindow(ptr, left);
+
+		if (!okTX)
+		{
+			LOG_ERROR("SEND END size(%u/%u), ack(%i)", _TXInit.Size, szData, ack);
+			return false;
+		}
+
+		ptr += left;
+		left = 0;
+	}
 	
-	// send part packets
+	// send part packets, without ack they follow init packet at once (size of previous packet is
+	// counted as part data, so init packet is longer by its larger packet info)
 	
+	size_t szPrev = GetSzInfoInit(&_TXInit) - SZ_INFO_PART + _TXInit.Size;
 	while (left)
 	{
 		_TXPart.Size = left < _szDataMaxPart ? left : _szDataMaxPart;
 		_TXPart.SegId++;
+		_TXPart.End = _TXPart.Size == left;
 
-		okTX = _send(&_TXPart, sizeof(_TXPart), ptr);
+		if (!_TXInit.Ack)
+		{
+			_waitGap(szPrev, _TXPart.Size);
+			szPrev = _TXPart.Size;
+		}
+
+		okTX = _send(&_TXPart, ptr);
 
 		if (!okTX)
 		{
-#ifdef _DEBUG_COMM_SR
-			printf(RED "[ERROR]" WHITE " SEND END size(%u/%u), ack(%i)\n", szData - left, szData, ack);
-#endif
+			LOG_ERROR("SEND END size(%u/%u), ack(%i)", szData - left, szData, ack);
 			return false;
 		}
 
@@ -194,48 +409,104 @@ bool Comm::Send(const void *pData, size_t szData, bool ack)
 		left -= _TXPart.Size;
 	}
 
-	// end communication and send empty packet if ack is requested
-	
-	if (ack)
-	{	
-		_TXPart.Size = 0;
-		_TXPart.SegId++;
+	LOG_OK("SEND END size(%u/%u), ack(%i)", szData - left, szData, ack);
 
-		okTX = _send(&_TXPart, sizeof(_TXPart), NULL);
+	_msgLatency.Record(clk.Now());
 
-		_TXPart.SegId++;
+	return true;
+}
+
+bool Comm::SendStream(istream &is, bool ack, size_t *pSzDataTX)
+{
+	LOG_OK("SEND STREAM START ack(%i)", ack);
+
+	Clock clk;
 
-		okTX = _send(&_TXPart, sizeof(_TXPart), NULL);
+	// init packet may follow last packet of previous message sent without ack
+
+	if (!_TXInit.Ack)
+	{
+		_waitGap(0, 0);
 	}
 
-#ifdef _DEBUG_COMM_SR
-	printf(GREEN "[OK]" WHITE " SEND END size(%u/%u), ack(%i)\n", szData - left, szData, ack);
-#endif
+	// set init packet info, size of stream is unknown and init packet carries no data
 
-	return true;
+	_TXInit.Session = _TXPart.Session = ++_session;
+	_TXInit.Ack = ack;
+	_TXInit.Compress = false;
+	_TXInit.Stream = true;
+	_TXInit.Window = ack ? _window : 1;
+	_TXInit.SizeTotal = 0;
+	_TXInit.Size = 0;
+
+	bool okTX = _send(&_TXInit, NULL);
+	_TXInit.Stream = false;
+
+	if (pSzDataTX)
+	{
+		*pSzDataTX = 0;
+	}
+
+	if (!okTX)
+	{
+		LOG_ERROR("SEND STREAM END size(0), ack(%i)", ack);
+		return false;
+	}
+
+	size_t sent;
+	okTX = _sendStream(is, &sent);
+
+	if (pSzDataTX)
+	{
+		*pSzDataTX = sent;
+	}
+
+	LOG_RESULT(okTX, "SEND STREAM END size(%u), ack(%i)", sent, ack);
+
+	if (okTX)
+	{
+		_msgLatency.Record(clk.Now());
+	}
+
+	return okTX;
 }
 
 bool Comm::Receive(void *pData, size_t szData, size_t *pSzDataRX)
+{
+	size_t szRX;
+	bool okRX = _receiveMsg(pData, szData, &szRX);
+
+	if (okRX && _RXInfo.Compress)
+	{
+		okRX = _decompress(pData, szData, &szRX);
+	}
+
+	if (pSzDataRX)
+	{
+		*pSzDataRX = szRX;
+	}
+
+	return okRX;
+}
+
+bool Comm::_receiveMsg(void *pData, size_t szData, size_t *pSzDataRX)
 {
 	char *ptr = static_cast<char*>(pData);
 	size_t szLeft = szData;
 
-#ifdef _DEBUG_COMM_SR
-	printf(GREEN "[OK]" WHITE " RECEIVE START size(%u)\n", szData);
-#endif
+	LOG_OK("RECEIVE START size(%u)", szData);
 
 	_RXInfo.SegId = 0;
+	bool end = false;
 
-	// start receiving until all packets have been received
+	// start receiving until last packet of message is received
 	
 	do
 	{
 		bool okRX = _receive(ptr, szLeft);
 		if (!okRX)
 		{
-#ifdef _DEBUG_COMM_SR
-			printf(RED "[ERROR]" WHITE " RECEIVE END size(%u/%u)\n", szData, _RXInfo.SegId ? _RXInfo.SizeTotal : 0);
-#endif
+			LOG_ERROR("RECEIVE END size(%u/%u)", szData, _RXInfo.SegId ? _RXInfo.SizeTotal : 0);
 			if (pSzDataRX)
 			{
 				*pSzDataRX = _RXInfo.SegId ? _RXInfo.SizeTotal : 0;
@@ -248,14 +519,40 @@ bool Comm::Receive(void *pData, size_t szData, size_t *pSzDataRX)
 
 		if (_pRXPart->SegId == _RXInfo.SegId)
 		{
+			// data which do not fit into pData are not copied
+
+			size_t szCopy = szLeft > _pRXPart->Size ? _pRXPart->Size : szLeft;
+			szLeft -= szCopy;
+			ptr += szCopy;
+			end = _pRXPart->End;
+
 			// if appropriate init packet is received
 
 			if (!_RXInfo.SegId)
 			{
 				_RXInfo.SegId++;
 				_RXInfo.SizeTotal = _pRXInit->SizeTotal;
-				szLeft = (_RXInfo.SizeTotal > szData ? szData : _RXInfo.SizeTotal) - _pRXInit->Size;
-				ptr += _pRXInit->Size;
+
+				// if window is requested receive all part packets at once
+
+				size_t szParts = _RXInfo.SizeTotal - _pRXInit->Size;
+				if (_RXInfo.Window > 1 && _RXInfo.Ack && szParts && !end)
+				{
+					okRX = _receiveWindow(ptr, szLeft, szParts);
+					if (!okRX)
+					{
+						LOG_ERROR("RECEIVE END size(%u/%u)", szData, _RXInfo.SizeTotal);
+						if (pSzDataRX)
+						{
+							*pSzDataRX = _RXInfo.SizeTotal;
+						}
+
+						return false;
+					}
+
+					szLeft -= szLeft > szParts ? szParts : szLeft;
+					end = true;
+				}
 			}
 
 			// if appropriate part packet is received
@@ -263,8 +560,6 @@ bool Comm::Receive(void *pData, size_t szData, size_t *pSzDataRX)
 			else
 			{
 				_RXInfo.SegId++;
-				szLeft -= _pRXPart->Size;
-				ptr += _pRXPart->Size;
 			}
 		}
 		else
@@ -277,9 +572,7 @@ bool Comm::Receive(void *pData, size_t szData, size_t *pSzDataRX)
 			}
 			else
 			{
-#ifdef _DEBUG_COMM_SR
-				printf(RED "[ERROR]" WHITE " RECEIVE END size(%u/%u)\n", szData, _RXInfo.SegId ? _RXInfo.SizeTotal : 0);
-#endif
+				LOG_ERROR("RECEIVE END size(%u/%u)", szData, _RXInfo.SegId ? _RXInfo.SizeTotal : 0);
 				if (pSzDataRX)
 				{
 					*pSzDataRX = _RXInfo.SegId ? _RXInfo.SizeTotal : 0;
@@ -287,43 +580,119 @@ bool Comm::Receive(void *pData, size_t szData, size_t *pSzDataRX)
 				return false;
 			}
 		}
-	} while (szLeft);
+	} while (!end);
 
-	// if ack is requested, receive last two packets which are used to signal end of communication
+	// last packet is acknowledged again if sending node repeats it
 
-	if (_RXInfo.Ack)
-	{
-		_receive(NULL, 0);
-		_receive(NULL, 0);
-	}
+	_RXEnd = true;
+	_RXEndTime = Clock::Total();
 
 	if (pSzDataRX)
 	{
 		*pSzDataRX = _RXInfo.SizeTotal;
 	}
 
-#ifdef _DEBUG_COMM_SR
-	printf(	GREEN "[OK]" WHITE " RECEIVE END size(%u/%u)\n",
-		(_RXInfo.SizeTotal > szData ? szData : _RXInfo.SizeTotal) - _pRXInit->Size,
-		_RXInfo.SizeTotal);
-#endif
+	LOG_OK("RECEIVE END size(%u/%u)",
+		szData - szLeft, _RXInfo.SizeTotal);
+
+	return true;
+}
+
+bool Comm::Linger()
+{
+	if (!_RXEnd || !_RXInfo.Ack)
+	{
+		return true;
+	}
+
+	// wait for first two repeats of last packet, timeout is doubled after each repeat
+
+	double toLinger = _pRTO->GetBudget(1) + _airtime(_szBufTX) + _szBufTX * _tByteUART + _toProc;
+
+	_clk.Reset();
+
+	double time;
+	while ((time = _clk.Now()) < toLinger)
+	{
+		size_t szRX;
+		size_t szInfo = _receiveInfo(&szRX, toLinger - time);
+		if (!szInfo || !_repeatedEnd(szRX))
+		{
+			continue;
+		}
+
+		bool okTX = _sendAckEnd();
+		if (!okTX)
+		{
+			return false;
+		}
+
+		toLinger *= 2.0;
+		_clk.Reset();
+	}
 
 	return true;
 }
 
+bool Comm::ReceiveStream(ostream &os, size_t *pSzDataRX)
+{
+	LOG_OK("RECEIVE STREAM START");
+
+	if (pSzDataRX)
+	{
+		*pSzDataRX = 0;
+	}
+
+	// wait for init packet
+
+	do
+	{
+		bool okRX = _receive(NULL, 0);
+		if (!okRX)
+		{
+			LOG_ERROR("RECEIVE STREAM END size(0)");
+			return false;
+		}
+	} while (_pRXPart->SegId);
+
+	if (!_RXInfo.Stream)
+	{
+		LOG_ERROR("RECEIVE STREAM END size(0), message is not stream");
+		return false;
+	}
+
+	size_t received;
+	bool okRX = _receiveStream(os, &received);
+
+	if (pSzDataRX)
+	{
+		*pSzDataRX = received;
+	}
+
+	LOG_RESULT(okRX, "RECEIVE STREAM END size(%u)", received);
+
+	return okRX;
+}
+
 bool Comm::EncryptPubSend(const void *pData, size_t szData, bool ack)
 {
 	if (szData > _szDecryptBuf)
 	{
-#ifdef _DEBUG_CRYPT
-		printf(RED "[ERROR]" WHITE " ENCRYPT PUB START decryptSize(%u), maxDecryptSize(%u)\n", szData, _szDecryptBuf);
-#endif
+		LOG_ERROR("ENCRYPT PUB START decryptSize(%u), maxDecryptSize(%u)", szData, _szDecryptBuf);
 		return false;
 	}
 
-#ifdef _DEBUG_CRYPT
-	printf(GREEN "[OK]" WHITE " ENCRYPT PUB START decryptSize(%u), maxDecryptSize(%u)\n", szData, _szDecryptBuf);
-#endif
+	LOG_OK("ENCRYPT PUB START decryptSize(%u), maxDecryptSize(%u)", szData, _szDecryptBuf);
+
+	// compress data before encryption (encrypted data cannot be compressed)
+
+	size_t szComp = _compress(pData, szData);
+	bool compress = szComp;
+	if (compress)
+	{
+		pData = _pCompBuf;
+		szData = szComp;
+	}
 
 	const unsigned char *ptr = static_cast<const unsigned char*>(pData);
 	const unsigned char *pFrom = ptr;
@@ -346,41 +715,41 @@ bool Comm::EncryptPubSend(const void *pData, size_t szData, bool ack)
 
 		if (szEncrypted == -1)
 		{
-#ifdef _DEBUG_CRYPT
-			printf(RED "[ERROR]" WHITE " ENCRYPT PUB decryptSize(%u), encryptSize(0)\n", sz);
-#endif
+			LOG_ERROR("ENCRYPT PUB decryptSize(%u), encryptSize(0)", sz);
 			return false;
 		}
 
-#ifdef _DEBUG_CRYPT
-		printf(GREEN "[OK]" WHITE " ENCRYPT PUB decryptSize(%u), encryptSize(%i)\n", sz, szEncrypted);
-#endif
+		LOG_OK("ENCRYPT PUB decryptSize(%u), encryptSize(%i)", sz, szEncrypted);
 
 		pFrom += sz;
 		pTo += szEncrypted;
 		szLeft = szData - (pFrom - ptr);
 	} while(szLeft);
 
-#ifdef _DEBUG_CRYPT
-	printf(GREEN "[OK]" WHITE " ENCRYPT PUB END decryptSize(%u), encryptSize(%u)\n", pFrom - ptr, pTo - _pEncryptBuf);
-#endif
+	LOG_OK("ENCRYPT PUB END decryptSize(%u), encryptSize(%u)", pFrom - ptr, pTo - _pEncryptBuf);
 
- 	return Send(_pEncryptBuf, pTo - _pEncryptBuf, ack);
+ 	return _sendMsg(_pEncryptBuf, pTo - _pEncryptBuf, ack, compress);
 }
 
 bool Comm::EncryptPvtSend(const void *pData, size_t szData, bool ack)
 {
 	if (szData > _szDecryptBuf)
 	{
-#ifdef _DEBUG_CRYPT
-		printf(RED "[ERROR]" WHITE " ENCRYPT PVT START decryptSize(%u), maxDecryptSize(%u)\n", szData, _szDecryptBuf);
-#endif
+		LOG_ERROR("ENCRYPT PVT START decryptSize(%u), maxDecryptSize(%u)", szData, _szDecryptBuf);
 		return false;
 	}
 
-#ifdef _DEBUG_CRYPT
-	printf(GREEN "[OK]" WHITE " ENCRYPT PVT START decryptSize(%u), maxDecryptSize(%u)\n", szData, _szDecryptBuf);
-#endif
+	LOG_OK("ENCRYPT PVT START decryptSize(%u), maxDecryptSize(%u)", szData, _szDecryptBuf);
+
+	// compress data before encryption (encrypted data cannot be compressed)
+
+	size_t szComp = _compress(pData, szData);
+	bool compress = szComp;
+	if (compress)
+	{
+		pData = _pCompBuf;
+		szData = szComp;
+	}
 
 	const unsigned char *ptr = static_cast<const unsigned char*>(pData);
 	const unsigned char *pFrom = ptr;
@@ -401,86 +770,188 @@ bool Comm::EncryptPvtSend(const void *pData, size_t szData, bool ack)
 
 		if (szEncrypted == -1)
 		{
-#ifdef _DEBUG_CRYPT
-			printf(RED "[ERROR]" WHITE " ENCRYPT PVT decryptSize(%u), encryptSize(0)\n", sz);
-#endif
+			LOG_ERROR("ENCRYPT PVT decryptSize(%u), encryptSize(0)", sz);
 			return false;
 		}
 
-#ifdef _DEBUG_CRYPT
-		printf(GREEN "[OK]" WHITE " ENCRYPT PVT decryptSize(%u), encryptSize(%i)\n", sz, szEncrypted);
-#endif
+		LOG_OK("ENCRYPT PVT decryptSize(%u), encryptSize(%i)", sz, szEncrypted);
 
 		pFrom += sz;
 		pTo += szEncrypted;
 		szLeft = szData - (pFrom - ptr); 
 	} while(szLeft);
 
-#ifdef _DEBUG_CRYPT
-	printf(GREEN "[OK]" WHITE " ENCRYPT PVT END decryptSize(%u), encryptSize(%u)\n", pFrom - ptr, pTo - _pEncryptBuf);
-#endif
+	LOG_OK("ENCRYPT PVT END decryptSize(%u), encryptSize(%u)", pFrom - ptr, pTo - _pEncryptBuf);
 
- 	return Send(_pEncryptBuf, pTo - _pEncryptBuf, ack);
+ 	return _sendMsg(_pEncryptBuf, pTo - _pEncryptBuf, ack, compress);
 }
 
-bool Comm::ReceiveDecryptPub(void *pData, size_t szData, size_t *pSzDataRX)
+bool Comm::EncryptSymSend(const void *pData, size_t szData, bool ack)
 {
-	size_t szLeft;
-	bool okRX = Receive(_pEncryptBuf, _szEncryptBuf, &szLeft);
-
-	if (!okRX)
+	if (!_pSymCtx || szData > _szSymBuf)
 	{
-		if (pSzDataRX)
-		{
-			*pSzDataRX = 0;
-		}
-#ifdef _DEBUG_CRYPT
-		printf(RED "[ERROR]" WHITE " DECRYPT PUB START encryptSize(%u), maxDecryptSize(%u)\n", szLeft, szData);
-#endif
+		LOG_ERROR("ENCRYPT SYM START decryptSize(%u), maxDecryptSize(%u)", szData, _szSymBuf);
 		return false;
 	}
 
-#ifdef _DEBUG_CRYPT
-	printf(GREEN "[OK]" WHITE " DECRYPT PUB START encryptSize(%u), maxDecryptSize(%u)\n", szLeft, szData);
-#endif
+	// compress data before encryption (encrypted data cannot be compressed)
 
-	size_t szFree = szData;
-	int szDecrypt;
-	unsigned char *ptr = static_cast<unsigned char*>(pData);
-	unsigned char *pFrom = _pEncryptBuf;
-	unsigned char *pTo = ptr;
+	size_t szComp = _compress(pData, szData);
+	bool compress = szComp;
+	if (compress)
+	{
+		pData = _pCompBuf;
+		szData = szComp;
+	}
 
-	do
+	// nonce must not repeat with the same key, new session key is attached if counter overflows
+
+	if (!++_symCounterTX)
 	{
-		size_t sz = szLeft > _szRSAPub ? _szRSAPub : szLeft;
+		_symCounterTX = 1;
+		_bSymKeySent = false;
+	}
 
-		if (szFree >= _szRSAPvt)
-		{
-			szDecrypt = RSA_public_decrypt(
-				sz,
-				pFrom,
-				pTo,
-				_pRSAPub,
-				RSA_PKCS1_PADDING);
+	// receiving node may have lost session key (restart), there is no response to message which it
+	// cannot decrypt, so key is attached periodically
 
-			if (szDecrypt == -1)
-			{
-				if (pSzDataRX)
-				{
-					*pSzDataRX = pTo - ptr;
-				}
-#ifdef _DEBUG_CRYPT
-				printf(RED "[ERROR]" WHITE " DECRYPT PUB encryptSize(%u), decryptSize(0), available(%u)\n", sz, szFree);
-#endif
-				return false;
-			}
+	if (_symCounterTX % _symKeyRefresh == 0)
+	{
+		_bSymKeySent = false;
+	}
 
-#ifdef _DEBUG_CRYPT
-			printf(GREEN "[OK]" WHITE " DECRYPT PUB encryptSize(%u), decryptSize(%i), available(%u)\n", sz, szDecrypt, szFree);
-#endif
-		}
-		else
-		{
+	// each attached key is new and its epoch is greater than epoch of previous key (also after restart
+	// of this node as it is taken from clock), so receiving node rejects replayed message with older key
+
+	if (!_bSymKeySent)
+	{
+		if (RAND_bytes(_symKeyTX, _szSymKey) != 1)
+		{
+			return false;
+		}
+
+		uint64_t time = static_cast<uint64_t>(Clock::Total());
+		_symEpochTX = time > _symEpochTX ? time : _symEpochTX + 1;
+	}
+
+	LOG_OK("ENCRYPT SYM START decryptSize(%u), maxDecryptSize(%u), counter(%u), key(%i)", szData, _szSymBuf, _symCounterTX, !_bSymKeySent);
+
+	// session info: flags, message counter (little endian)
+
+	_pSymBuf[0] = _bSymKeySent ? 0 : _symFKey;
+	_pSymBuf[1] = _symCounterTX;
+	_pSymBuf[2] = _symCounterTX >> 8;
+	_pSymBuf[3] = _symCounterTX >> 16;
+	_pSymBuf[4] = _symCounterTX >> 24;
+
+	size_t szInfo = _szSymInfo;
+
+	// encrypt session key and its epoch (little endian) with public key until it is acknowledged
+
+	if (!_bSymKeySent)
+	{
+		unsigned char block[sizeof(_symKeyTX) + sizeof(_symEpochTX)];
+		memcpy(block, _symKeyTX, _szSymKey);
+		for (size_t i = 0; i < _szSymEpoch; i++)
+		{
+			block[_szSymKey + i] = _symEpochTX >> (8 * i);
+		}
+
+		double time = _clk.Total();
+		RAND_seed(&time, sizeof(double));
+		int szEncrypted = RSA_public_encrypt(
+			_szSymKey + _szSymEpoch,
+			block,
+			_pSymBuf + szInfo,
+			_pRSAPub,
+			RSA_PKCS1_OAEP_PADDING);
+		OPENSSL_cleanse(block, sizeof(block));
+
+		if (szEncrypted == -1)
+		{
+			LOG_ERROR("ENCRYPT SYM KEY decryptSize(%u), encryptSize(0)", _szSymKey);
+			return false;
+		}
+
+		szInfo += szEncrypted;
+	}
+
+	memcpy(_pSymBuf + szInfo, pData, szData);
+
+	bool okCrypt = _symCrypt(true, _symKeyTX, _symCounterTX, _pSymBuf, szInfo, szData, _pSymBuf + szInfo + szData);
+	if (!okCrypt)
+	{
+		LOG_ERROR("ENCRYPT SYM decryptSize(%u), encryptSize(0)", szData);
+		return false;
+	}
+
+	size_t szMsg = szInfo + szData + _szSymTag;
+
+	LOG_OK("ENCRYPT SYM END decryptSize(%u), encryptSize(%u)", szData, szMsg);
+
+	bool okSend = _sendMsg(_pSymBuf, szMsg, ack, compress);
+
+	// session key is known to receiving node only if message is acknowledged, failed send may be caused
+	// by restart of receiving node
+
+	if (ack)
+	{
+		_bSymKeySent = okSend;
+	}
+
+	return okSend;
+}
+
+bool Comm::ReceiveDecryptPub(void *pData, size_t szData, size_t *pSzDataRX)
+{
+	size_t szLeft;
+	bool okRX = _receiveMsg(_pEncryptBuf, _szEncryptBuf, &szLeft);
+
+	if (!okRX)
+	{
+		if (pSzDataRX)
+		{
+			*pSzDataRX = 0;
+		}
+		LOG_ERROR("DECRYPT PUB START encryptSize(%u), maxDecryptSize(%u)", szLeft, szData);
+		return false;
+	}
+
+	LOG_OK("DECRYPT PUB START encryptSize(%u), maxDecryptSize(%u)", szLeft, szData);
+
+	size_t szFree = szData;
+	int szDecrypt;
+	unsigned char *ptr = static_cast<unsigned char*>(pData);
+	unsigned char *pFrom = _pEncryptBuf;
+	unsigned char *pTo = ptr;
+
+	do
+	{
+		size_t sz = szLeft > _szRSAPub ? _szRSAPub : szLeft;
+
+		if (szFree >= _szRSAPvt)
+		{
+			szDecrypt = RSA_public_decrypt(
+				sz,
+				pFrom,
+				pTo,
+				_pRSAPub,
+				RSA_PKCS1_PADDING);
+
+			if (szDecrypt == -1)
+			{
+				if (pSzDataRX)
+				{
+					*pSzDataRX = pTo - ptr;
+				}
+				LOG_ERROR("DECRYPT PUB encryptSize(%u), decryptSize(0), available(%u)", sz, szFree);
+				return false;
+			}
+
+			LOG_OK("DECRYPT PUB encryptSize(%u), decryptSize(%i), available(%u)", sz, szDecrypt, szFree);
+		}
+		else
+		{
 			szDecrypt = RSA_public_decrypt(
 				sz,
 				pFrom,
@@ -494,18 +965,14 @@ bool Comm::ReceiveDecryptPub(void *pData, size_t szData, size_t *pSzDataRX)
 				{
 					*pSzDataRX = pTo - ptr;
 				}
-#ifdef _DEBUG_CRYPT
-				printf(RED "[ERROR]" WHITE " DECRYPT PUB encryptSize(%u), decryptSize(0), available(%u)\n", sz, szFree);
-#endif
+				LOG_ERROR("DECRYPT PUB encryptSize(%u), decryptSize(0), available(%u)", sz, szFree);
 				return false;
 			}
 		
 			if (szFree > szDecrypt)
 			{
 				memcpy(pTo, _pDecryptBuf, szDecrypt);
-#ifdef _DEBUG_CRYPT
-				printf(GREEN "[OK]" WHITE " DECRYPT PUB encryptSize(%u), decryptSize(%i), available(%u)\n", sz, szDecrypt, szFree);
-#endif
+				LOG_OK("DECRYPT PUB encryptSize(%u), decryptSize(%i), available(%u)", sz, szDecrypt, szFree);
 			}
 			else
 			{
@@ -514,9 +981,7 @@ bool Comm::ReceiveDecryptPub(void *pData, size_t szData, size_t *pSzDataRX)
 				{
 					*pSzDataRX = pTo - ptr + szFree;
 				}
-#ifdef _DEBUG_CRYPT
-				printf(RED "[ERROR]" WHITE " DECRYPT PUB encryptSize(%u), decryptSize(%i), available(%u)\n", sz, szDecrypt, szFree);
-#endif
+				LOG_ERROR("DECRYPT PUB encryptSize(%u), decryptSize(%i), available(%u)", sz, szDecrypt, szFree);
 				return false;
 			}
 		}
@@ -528,14 +993,20 @@ bool Comm::ReceiveDecryptPub(void *pData, size_t szData, size_t *pSzDataRX)
 	} while (szLeft);
 
 
+	size_t szRX = pTo - ptr;
+	bool okDecomp = !_RXInfo.Compress || _decompress(pData, szData, &szRX);
+
 	if (pSzDataRX)
 	{
-		*pSzDataRX = pTo - ptr;
+		*pSzDataRX = szRX;
+	}
+
+	if (!okDecomp)
+	{
+		return false;
 	}
 
-#ifdef _DEBUG_CRYPT
-	printf(GREEN "[OK]" WHITE " DECRYPT PUB END encryptSize(%u), decryptSize(%u)\n", pFrom - _pEncryptBuf, pTo - ptr);
-#endif
+	LOG_OK("DECRYPT PUB END encryptSize(%u), decryptSize(%u)", pFrom - _pEncryptBuf, pTo - ptr);
 
  	return true; 
 }
@@ -543,7 +1014,7 @@ bool Comm::ReceiveDecryptPub(void *pData, size_t szData, size_t *pSzDataRX)
 bool Comm::ReceiveDecryptPvt(void *pData, size_t szData, size_t *pSzDataRX)
 {
 	size_t szLeft;
-	bool okRX = Receive(_pEncryptBuf, _szEncryptBuf, &szLeft);
+	bool okRX = _receiveMsg(_pEncryptBuf, _szEncryptBuf, &szLeft);
 
 	if (!okRX)
 	{
@@ -551,15 +1022,11 @@ bool Comm::ReceiveDecryptPvt(void *pData, size_t szData, size_t *pSzDataRX)
 		{
 			*pSzDataRX = 0;
 		}
-#ifdef _DEBUG_CRYPT
-		printf(RED "[ERROR]" WHITE " DECRYPT PVT START encryptSize(%u), maxDecryptSize(%u)\n", szLeft, szData);
-#endif
+		LOG_ERROR("DECRYPT PVT START encryptSize(%u), maxDecryptSize(%u)", szLeft, szData);
 		return false;
 	}
 
-#ifdef _DEBUG_CRYPT
-	printf(GREEN "[OK]" WHITE " DECRYPT PVT START encryptSize(%u), maxDecryptSize(%u)\n", szLeft, szData);
-#endif
+	LOG_OK("DECRYPT PVT START encryptSize(%u), maxDecryptSize(%u)", szLeft, szData);
 
 	size_t szFree = szData;
 	int szDecrypt;
@@ -586,14 +1053,10 @@ bool Comm::ReceiveDecryptPvt(void *pData, size_t szData, size_t *pSzDataRX)
 				{
 					*pSzDataRX = pTo - ptr;
 				}
-#ifdef _DEBUG_CRYPT
-				printf(RED "[ERROR]" WHITE " DECRYPT PVT encryptSize(%u), decryptSize(0), available(%u)\n", sz, szFree);
-#endif
+				LOG_ERROR("DECRYPT PVT encryptSize(%u), decryptSize(0), available(%u)", sz, szFree);
 				return false;
 			}
-#ifdef _DEBUG_CRYPT
-			printf(GREEN "[OK]" WHITE " DECRYPT PVT encryptSize(%u), decryptSize(%i), available(%u)\n", sz, szDecrypt, szFree);
-#endif
+			LOG_OK("DECRYPT PVT encryptSize(%u), decryptSize(%i), available(%u)", sz, szDecrypt, szFree);
 		}
 		else
 		{
@@ -610,18 +1073,14 @@ bool Comm::ReceiveDecryptPvt(void *pData, size_t szData, size_t *pSzDataRX)
 				{
 					*pSzDataRX = pTo - ptr;
 				}
-#ifdef _DEBUG_CRYPT
-				printf(RED "[ERROR]" WHITE " DECRYPT PVT encryptSize(%u), decryptSize(0), available(%u)\n", sz, szFree);
-#endif
+				LOG_ERROR("DECRYPT PVT encryptSize(%u), decryptSize(0), available(%u)", sz, szFree);
 				return false;
 			}
 
 			if (szFree > szDecrypt)
 			{
 				memcpy(pTo, _pDecryptBuf, szDecrypt);
-#ifdef _DEBUG_CRYPT
-				printf(GREEN "[OK]" WHITE " DECRYPT PVT encryptSize(%u), decryptSize(%i), available(%u)\n", sz, szDecrypt, szFree);
-#endif
+				LOG_OK("DECRYPT PVT encryptSize(%u), decryptSize(%i), available(%u)", sz, szDecrypt, szFree);
 			}
 			else
 			{
@@ -630,9 +1089,7 @@ bool Comm::ReceiveDecryptPvt(void *pData, size_t szData, size_t *pSzDataRX)
 				{
 					*pSzDataRX = pTo - ptr + szFree;
 				}
-#ifdef _DEBUG_CRYPT
-				printf(RED "[ERROR]" WHITE " DECRYPT PVT encryptSize(%u), decryptSize(%i), available(%u)\n", sz, szDecrypt, szFree);
-#endif
+				LOG_ERROR("DECRYPT PVT encryptSize(%u), decryptSize(%i), available(%u)", sz, szDecrypt, szFree);
 				return false;
 			}
 		}
@@ -644,29 +1101,241 @@ bool Comm::ReceiveDecryptPvt(void *pData, size_t szData, size_t *pSzDataRX)
 		
 	} while (szLeft);
 
+	size_t szRX = pTo - ptr;
+	bool okDecomp = !_RXInfo.Compress || _decompress(pData, szData, &szRX);
+
 	if (pSzDataRX)
 	{
-		*pSzDataRX = pTo - ptr;
+		*pSzDataRX = szRX;
+	}
+
+	if (!okDecomp)
+	{
+		return false;
 	}
 
-#ifdef _DEBUG_CRYPT
-	printf(GREEN "[OK]" WHITE " DECRYPT PUB END encryptSize(%u), decryptSize(%u)\n", pFrom - _pEncryptBuf, pTo - ptr);
-#endif
+	LOG_OK("DECRYPT PUB END encryptSize(%u), decryptSize(%u)", pFrom - _pEncryptBuf, pTo - ptr);
 
  	return true; 
 }
 
+bool Comm::ReceiveDecryptSym(void *pData, size_t szData, size_t *pSzDataRX)
+{
+	if (pSzDataRX)
+	{
+		*pSzDataRX = 0;
+	}
+
+	size_t szMsg;
+	bool okRX = _pSymCtx && _receiveMsg(_pSymBuf, _szDataMax, &szMsg);
+
+	if (!okRX || szMsg < _szSymInfo + _szSymTag || szMsg > _szDataMax)
+	{
+		LOG_ERROR("DECRYPT SYM START encryptSize(%u), maxDecryptSize(%u)", okRX ? szMsg : 0, szData);
+		return false;
+	}
+
+	unsigned int counter =	static_cast<unsigned int>(_pSymBuf[1]) |
+				static_cast<unsigned int>(_pSymBuf[2]) << 8 |
+				static_cast<unsigned int>(_pSymBuf[3]) << 16 |
+				static_cast<unsigned int>(_pSymBuf[4]) << 24;
+
+	LOG_OK("DECRYPT SYM START encryptSize(%u), maxDecryptSize(%u), counter(%u), key(%i)", szMsg, szData, counter, _pSymBuf[0] & _symFKey);
+
+	size_t szInfo = _szSymInfo;
+	unsigned char key[sizeof(_symKeyRX)];
+	uint64_t epoch = 0;
+
+	if (_pSymBuf[0] & _symFKey)
+	{
+		// decrypt new session key and its epoch with private key (encrypt buffer holds whole RSA block)
+
+		if (szMsg < _szSymInfo + _szRSAPub + _szSymTag)
+		{
+			return false;
+		}
+
+		int szDecrypt = RSA_private_decrypt(
+			_szRSAPub,
+			_pSymBuf + szInfo,
+			_pEncryptBuf,
+			_pRSAPvt,
+			RSA_PKCS1_OAEP_PADDING);
+
+		if (szDecrypt != static_cast<int>(_szSymKey + _szSymEpoch))
+		{
+			LOG_ERROR("DECRYPT SYM KEY encryptSize(%u), decryptSize(%i)", _szRSAPub, szDecrypt);
+			return false;
+		}
+
+		memcpy(key, _pEncryptBuf, _szSymKey);
+		for (size_t i = 0; i < _szSymEpoch; i++)
+		{
+			epoch |= static_cast<uint64_t>(_pEncryptBuf[_szSymKey + i]) << (8 * i);
+		}
+		OPENSSL_cleanse(_pEncryptBuf, szDecrypt);
+
+		szInfo += _szRSAPub;
+
+		// replayed message with older key must not replace current key (and its counter), otherwise
+		// all messages sent with older key could be replayed
+
+		if (epoch <= _symEpochRX)
+		{
+			LOG_ERROR("DECRYPT SYM epoch(%llu/%llu), counter(%u/%u)", epoch, _symEpochRX, counter, _symCounterRX);
+			return false;
+		}
+	}
+	else if (!_bSymKeyRecv || counter <= _symCounterRX)
+	{
+		// session key is unknown or message is replayed
+
+		LOG_ERROR("DECRYPT SYM counter(%u/%u), key(%i)", counter, _symCounterRX, _bSymKeyRecv);
+		return false;
+	}
+	else
+	{
+		memcpy(key, _symKeyRX, _szSymKey);
+	}
+
+	size_t szDecrypt = szMsg - szInfo - _szSymTag;
+	bool okCrypt = _symCrypt(false, key, counter, _pSymBuf, szInfo, szDecrypt, _pSymBuf + szInfo + szDecrypt);
+	if (!okCrypt)
+	{
+		LOG_ERROR("DECRYPT SYM encryptSize(%u), decryptSize(0)", szMsg);
+		return false;
+	}
+
+	// accept session key, its epoch and counter only from authenticated message
+
+	memcpy(_symKeyRX, key, _szSymKey);
+	_symCounterRX = counter;
+	if (epoch)
+	{
+		_symEpochRX = epoch;
+	}
+	_bSymKeyRecv = true;
+
+	size_t szCopy = szDecrypt < szData ? szDecrypt : szData;
+	memcpy(pData, _pSymBuf + szInfo, szCopy);
+
+	if (pSzDataRX)
+	{
+		*pSzDataRX = szCopy;
+	}
+
+	if (szCopy < szDecrypt)
+	{
+		LOG_ERROR("DECRYPT SYM END encryptSize(%u), decryptSize(%u), available(%u)", szMsg, szDecrypt, szData);
+		return false;
+	}
+
+	if (_RXInfo.Compress)
+	{
+		bool okDecomp = _decompress(pData, szData, &szCopy);
+
+		if (pSzDataRX)
+		{
+			*pSzDataRX = szCopy;
+		}
+
+		if (!okDecomp)
+		{
+			return false;
+		}
+	}
+
+	LOG_OK("DECRYPT SYM END encryptSize(%u), decryptSize(%u)", szMsg, szDecrypt);
+
+	return true;
+}
+
 size_t Comm::GetMaxSz() { return _szDataMax; }
 
 size_t Comm::GetSzEncryptBuf() { return _szEncryptBuf; }
 
 size_t Comm::GetSzDecryptBuf() { return _szDecryptBuf; }
 
-bool Comm::_send(const PacketInfoPart *pInfo, size_t szInfo, const char *pData)
+size_t Comm::GetSzSymBuf() { return _szSymBuf; }
+
+size_t Comm::GetRetransmit() { return _metrics.Get(METRETRANSMIT); }
+
+const Histogram &Comm::GetAckRTT() { return _ackRTT; }
+
+const Histogram &Comm::GetMsgLatency() { return _msgLatency; }
+
+const Histogram &Comm::GetTXLatency() { return _rn.GetTXLatency(); }
+
+bool Comm::SetMetrics(const char *pName) { return _metrics.Create(pName); }
+
+bool Comm::SetCapture(const char *pFile) { return _rn.SetCapture(pFile); }
+
+void Comm::PrintLatency()
+{
+	// receiving node has no acks and messages of its own
+
+	if (_ackRTT.GetCount())
+	{
+		_ackRTT.Print("ack rtt");
+	}
+
+	if (_msgLatency.GetCount())
+	{
+		_msgLatency.Print("message");
+	}
+
+	_rn.GetTXLatency().Print("tx command");
+}
+
+double Comm::GetGoodputMax(size_t szData, bool ack, bool stream)
+{
+	// air time of all frames of message as sent by _sendMsg or SendStream (without retransmissions)
+
+	unsigned char parity = _fec.GetParity();
+
+	PacketInfoInit info;
+	info.SizeTotal = stream ? 0 : szData;
+	size_t szInfoInit = GetSzInfoInit(&info);
+	size_t szDataInit = stream ? 0 : _szBufTX - szInfoInit - parity;
+	szDataInit = szData < szDataInit ? szData : szDataInit;
+
+	double time = _airtime(szInfoInit + szDataInit + parity);
+	if (ack)
+	{
+		time += _airtime(SZ_INFO_RSP + parity);
+	}
+
+	size_t left = szData - szDataInit;
+	size_t parts = left / _szDataMaxPart;
+	time += parts * _airtime(SZ_INFO_PART + _szDataMaxPart + parity);
+	if (left % _szDataMaxPart)
+	{
+		time += _airtime(SZ_INFO_PART + left % _szDataMaxPart + parity);
+		parts++;
+	}
+
+	// part packets are acknowledged one by one or once per window
+
+	if (ack && parts)
+	{
+		if (_window > 1 || stream)
+		{
+			time += (parts + _window - 1) / _window * _airtime(SZ_INFO_RSPWIN + parity);
+		}
+		else
+		{
+			time += parts * _airtime(SZ_INFO_RSP + parity);
+		}
+	}
+
+	return szData / time;
+}
+
+bool Comm::_send(const PacketInfoPart *pInfo, const char *pData)
 {
-	const char *pInfoUC = reinterpret_cast<const char*>(pInfo);
+	Trace::Span span("comm", "send", pInfo->SegId);
 
-	char retrySend = 0;
+	unsigned char retrySend = 0;
 	bool resend;
 	do
 	{
@@ -674,75 +1343,27 @@ bool Comm::_send(const PacketInfoPart *pInfo, size_t szInfo, const char *pData)
 		{
 			// maximum number of retries reached, raise error
 			
-#ifdef _DEBUG_COMM_TR
-			if (szInfo == sizeof(PacketInfoInit))
+			if (!pInfo->SegId)
 			{
-				printf(	RED "[ERROR]" WHITE " TX(%i) INIT, attempt(%i/%i), ack(%i), size(%u/%u)\n",
+				LOG_ERROR("TX(%i) INIT, attempt(%i/%i), ack(%i), size(%u/%u)",
 					pInfo->SegId, retrySend, _retrySend, _TXInit.Ack, pInfo->Size,
 					static_cast<const PacketInfoInit*>(pInfo)->SizeTotal);
 			}
 			else
 			{
-				printf(RED "[ERROR]" WHITE " TX(%i) PART, attempt(%i/%i), ack(%i), size(%u)\n",
+				LOG_ERROR("TX(%i) PART, attempt(%i/%i), ack(%i), size(%u)",
 					pInfo->SegId, retrySend, _retrySend, _TXInit.Ack, pInfo->Size);
 			}
-#endif
 
 			return false;
 		}
 
-		bool okTX;
-
-		char retryTX = 0;
-		do
+		Clock clk;
+		bool okTX = _transmit(pInfo, pData, retrySend, retrySend > 1);
+		if (!okTX)
 		{
-			if (retryTX++ > _retryTX)
-			{
-				// maximum number of retries reached, raise error
-
-#ifdef _DEBUG_COMM_TR
-			if (szInfo == sizeof(PacketInfoInit))
-			{
-				printf(	RED "[ERROR]" WHITE " TX(%i) INIT, attemptTX(%i/%i), ack(%i), size(%u/%u)\n",
-					pInfo->SegId, retryTX, _retryTX, _TXInit.Ack, pInfo->Size,
-					static_cast<const PacketInfoInit*>(pInfo)->SizeTotal);
-			}
-			else
-			{
-				printf(RED "[ERROR]" WHITE " TX(%i) PART, attemptTX(%i/%i), ack(%i), size(%u)\n",
-					pInfo->SegId, retryTX, _retryTX, _TXInit.Ack, pInfo->Size);
-			}
-#endif
-				return false;
-			}
-
-			// try to send data
-			
-			if (pInfo->Size)
-			{
-				okTX = _rn.TX(pInfoUC, szInfo, pData, pInfo->Size);
-			}
-			else
-			{
-				okTX = _rn.TX(pInfoUC, szInfo);
-			}
-
-#ifdef _DEBUG_COMM_TR
-			if (szInfo == sizeof(PacketInfoInit))
-			{
-				cout << (okTX ? GREEN "[OK]" WHITE : RED "[ERROR]" WHITE);
-				printf(	" TX(%i) INIT, attempt(%i), attemptTX(%i), ack(%i), size(%u/%u)\n",
-					pInfo->SegId, retrySend, retryTX, _TXInit.Ack, pInfo->Size,
-					static_cast<const PacketInfoInit*>(pInfo)->SizeTotal);
-			}
-			else
-			{
-				cout << (okTX ? GREEN "[OK]" WHITE : RED "[ERROR]" WHITE);
-				printf(	" TX(%i) PART, attempt(%i), attemptTX(%i), ack(%i), size(%u)\n",
-					pInfo->SegId, retrySend, retryTX, _TXInit.Ack, pInfo->Size);
-			}
-#endif
-		} while (!okTX);
+			return false;
+		}
 
 		// if data is successfully sent, wait for ack packet if requested
 		
@@ -751,51 +1372,47 @@ bool Comm::_send(const PacketInfoPart *pInfo, size_t szInfo, const char *pData)
 			// reset timeout counter
 			
 			_clk.Reset();
+			Trace::Span spanAck("comm", "ack wait", pInfo->SegId);
 
-			// exit following loop only if appropriate response has been received or timeout occured
+			// wait until appropriate response has been received or timeout occured
 
-			bool timeout = false;
 			double time;
-			do
-			{
-				size_t szRX;
-				do
-				{
-					// if timeout is reached
+			bool timeout = !_waitRsp(false, &time);
+			spanAck.End();
+			
+			resend = timeout ? timeout : (_pRXRsp->RequestResend || _pRXRsp->SegId != pInfo->SegId);
 
-					time = _clk.Now();
-					if (time > _toAck)
-					{
-						timeout = true;
-						continue;
-					}
+			// measure round-trip time only if packet is sent once (Karn's rule)
 
-					// receive ack
+			if (!timeout)
+			{
+				_ackRTT.Record(clk.Now());
+			}
 
-					szRX = _rn.RX(
-						reinterpret_cast<char*>(_pRXRsp),
-						sizeof(*_pRXRsp));
-				} while (szRX != sizeof(*_pRXRsp) && !timeout);
-			} while (!(_checkInfo(&_RXRsp, _pRXRsp)) && !timeout);
-			
-			resend = timeout ? timeout : (_pRXRsp->RequestResend || _pRXRsp->SegId != pInfo->SegId);
+			if (timeout)
+			{
+				_pRTO->Backoff();
+			}
+			else if (!resend && retrySend == 1)
+			{
+				_pRTO->Sample(_clk.Now());
+			}
+			_publishRTO(timeout);
 
-#ifdef _DEBUG_COMM_TR
 			if (timeout)
 			{
-				printf(BROWN "[WARNING]" WHITE " ACK timeout(%f)\n", time);
+				LOG_WARNING("ACK timeout(%f), rto(%f)", time, _pRTO->Get());
 			}
 			else if (resend)
 			{
-				printf(	BROWN "[WARNING]" WHITE " ACK(%i) seg(%i), requestResend(%i)\n",
+				LOG_WARNING("ACK(%i) seg(%i), requestResend(%i)",
 					pInfo->SegId, _pRXRsp->SegId, _pRXRsp->RequestResend);
 			}
 			else
 			{
-				printf(	GREEN "[OK]" WHITE " ACK(%i) seg(%i), requestResend(%i)\n",
-					pInfo->SegId, _pRXRsp->SegId, _pRXRsp->RequestResend);
+				LOG_OK("ACK(%i) seg(%i), requestResend(%i), srtt(%f), rto(%f)",
+					pInfo->SegId, _pRXRsp->SegId, _pRXRsp->RequestResend, _pRTO->GetSRTT(), _pRTO->Get());
 			}
-#endif
 		}
 		else
 		{
@@ -806,6 +1423,97 @@ bool Comm::_send(const PacketInfoPart *pInfo, size_t szInfo, const char *pData)
 	return true;
 }
 
+bool Comm::_transmit(const PacketInfoPart *pInfo, const char *pData, char attempt, bool retransmit)
+{
+	size_t szInfo = pInfo->SegId ?
+		EncodePart(pInfo, _pTXBuf) :
+		EncodeInit(static_cast<const PacketInfoInit*>(pInfo), _pTXBuf);
+
+	// whole frame is needed for parity bytes
+
+	if (pInfo->Size)
+	{
+		memcpy(_pTXBuf + szInfo, pData, pInfo->Size);
+	}
+
+	Trace::Span spanFEC("comm", "fec encode", szInfo + pInfo->Size);
+	size_t szFrame = _fec.Encode(_pTXBuf, szInfo + pInfo->Size);
+	spanFEC.End();
+
+	if (retransmit)
+	{
+		_metrics.Add(METRETRANSMIT);
+	}
+
+	bool okTX;
+
+	char retryTX = 0;
+	do
+	{
+		if (retryTX++ > _retryTX)
+		{
+			// maximum number of retries reached, raise error
+
+		if (!pInfo->SegId)
+		{
+			LOG_ERROR("TX(%i) INIT, attemptTX(%i/%i), ack(%i), size(%u/%u)",
+				pInfo->SegId, retryTX, _retryTX, _TXInit.Ack, pInfo->Size,
+				static_cast<const PacketInfoInit*>(pInfo)->SizeTotal);
+		}
+		else
+		{
+			LOG_ERROR("TX(%i) PART, attemptTX(%i/%i), ack(%i), size(%u)",
+				pInfo->SegId, retryTX, _retryTX, _TXInit.Ack, pInfo->Size);
+		}
+			return false;
+		}
+
+		// try to send data
+		
+		okTX = _tx(szFrame);
+
+		if (!pInfo->SegId)
+		{
+			LOG_RESULT(okTX, "TX(%i) INIT, attempt(%i), attemptTX(%i), ack(%i), size(%u/%u)",
+				pInfo->SegId, attempt, retryTX, _TXInit.Ack, pInfo->Size,
+				static_cast<const PacketInfoInit*>(pInfo)->SizeTotal);
+		}
+		else
+		{
+			LOG_RESULT(okTX, "TX(%i) PART, attempt(%i), attemptTX(%i), ack(%i), size(%u)",
+				pInfo->SegId, attempt, retryTX, _TXInit.Ack, pInfo->Size);
+		}
+	} while (!okTX);
+
+	return true;
+}
+
+bool Comm::_tx(size_t szFrame)
+{
+	Trace::Span span("comm", "tx", szFrame);
+
+	// watch dog timeout limits TX, frame must fit on air
+
+	double toTX = 2.0 * _airtime(szFrame) + _toProc;
+	if (_wdt < toTX * 1000.0)
+	{
+		bool okWDT = _setWDT(toTX);
+		if (!okWDT)
+		{
+			return false;
+		}
+	}
+
+	bool okTX = _rn.TX(_pTXBuf, szFrame);
+	if (okTX)
+	{
+		_metrics.Add(METFRAMESTX);
+		_metrics.AddAir(szFrame, _airtime(szFrame));
+	}
+
+	return okTX;
+}
+
 bool Comm::_sendAck()
 {
 	char retryTXAck = 0;
@@ -816,30 +1524,239 @@ bool Comm::_sendAck()
 		{
 			// maximum number of retries reached, raise error
 			
-#ifdef _DEBUG_COMM_TR
-			printf(RED "[ERROR]" WHITE " ACK attempt(%i/%i)\n", retryTXAck, _retryTXAck);
-#endif
+			LOG_ERROR("ACK attempt(%i/%i)", retryTXAck, _retryTXAck);
+
+			return false;
+		}
+
+		okTX = _tx(_fec.Encode(_pTXBuf, EncodeRsp(&_RXRsp, _pTXBuf)));
+		LOG_RESULT(okTX, "ACK(%i) attempt(%i/%i), requestResend(%i)", _RXRsp.SegId, retryTXAck, _retryTXAck, _RXRsp.RequestResend);
+	} while (!okTX);
+
+	return true;
+}
+
+bool Comm::_sendWindow(const char *pData, size_t szData)
+{
+	// part packets have segment ids from 1 to count
+
+	unsigned int count = (szData + _szDataMaxPart - 1) / _szDataMaxPart;
+	unsigned int base = 1;		// First segment which is not acknowledged.
+	unsigned int mask = 0;		// Bit i is set if segment base + i is acknowledged.
+	unsigned int sent = 0;		// Last segment which has been sent.
+
+	unsigned char retrySend = 0;
+	while (base <= count)
+	{
+		if (retrySend++ > _retrySend)
+		{
+			// maximum number of retries without progress reached, raise error
+
+			LOG_ERROR("TX WIN(%u-%u), attempt(%i/%i), mask(%08x)",
+				base, count, retrySend, _retrySend, mask);
+
+			return false;
+		}
+
+		// find last segment in window which is not acknowledged and poll after it
+
+		unsigned int end = count - base < _TXInit.Window ? count + 1 : base + _TXInit.Window;
+		unsigned int last = base;
+		for (unsigned int seg = base; seg < end; seg++)
+		{
+			if (!(mask >> (seg - base) & 1))
+			{
+				last = seg;
+			}
+		}
+
+		// send all segments in window which are not acknowledged
+
+		Clock clk;
+		size_t szPrev = 0;
+		for (unsigned int seg = base; seg <= last; seg++)
+		{
+			if (mask >> (seg - base) & 1)
+			{
+				continue;
+			}
+
+			size_t offset = (seg - 1) * _szDataMaxPart;
+			_TXPart.SegId = seg;
+			_TXPart.Size = szData - offset < _szDataMaxPart ? szData - offset : _szDataMaxPart;
+			_TXPart.Poll = seg == last;
+			_TXPart.End = seg == count;
+
+			if (szPrev)
+			{
+				_waitGap(szPrev, _TXPart.Size);
+			}
+			szPrev = _TXPart.Size;
+
+			// attempt restarts after progress of window, so gap resend is recognized by highest sent segment
+
+			bool okTX = _transmit(&_TXPart, pData + offset, retrySend, seg <= sent);
+			if (!okTX)
+			{
+				return false;
+			}
+		}
+
+		// measure round-trip time only if polled segment is sent first time (Karn's rule)
+
+		bool first = last > sent;
+		if (first)
+		{
+			sent = last;
+		}
+
+		// reset timeout counter
+		
+		_clk.Reset();
+		Trace::Span spanAck("comm", "ack window wait", last);
+
+		// wait until window response has been received or timeout occured
+
+		double time;
+		bool timeout = !_waitRsp(true, &time);
+		spanAck.End();
+
+		if (!timeout)
+		{
+			_ackRTT.Record(clk.Now());
+		}
+
+		if (timeout)
+		{
+			_pRTO->Backoff();
+		}
+		else if (first)
+		{
+			_pRTO->Sample(_clk.Now());
+		}
+		_publishRTO(timeout);
+
+		if (timeout)
+		{
+			LOG_WARNING("ACK WIN timeout(%f), rto(%f)", time, _pRTO->Get());
+			continue;
+		}
+
+		// move window to first segment which is not received and add received segments
+
+		unsigned int segRsp = _pRXRspWin->SegId;
+		unsigned int maskRsp = _pRXRspWin->Mask;
+		unsigned int baseOld = base;
+		unsigned int maskOld = mask;
+
+		if (segRsp > count + 1)
+		{
+			segRsp = count + 1;
+		}
+
+		if (segRsp > base)
+		{
+			mask = segRsp - base < _windowMax ? mask >> (segRsp - base) : 0;
+			base = segRsp;
+		}
+		else
+		{
+			maskRsp = base - segRsp < _windowMax ? maskRsp >> (base - segRsp) : 0;
+		}
+
+		mask |= maskRsp;
+		while (mask & 1)
+		{
+			base++;
+			mask >>= 1;
+		}
+
+		LOG_OK("ACK WIN(%u) seg(%u), mask(%08x), srtt(%f), rto(%f)",
+			last, _pRXRspWin->SegId, _pRXRspWin->Mask, _pRTO->GetSRTT(), _pRTO->Get());
+
+		if (base != baseOld || mask != maskOld)
+		{
+			retrySend = 0;
+		}
+	}
+
+	_TXPart.SegId = count;
+	_TXPart.Poll = false;
+	_TXPart.End = false;
+
+	return true;
+}
+
+bool Comm::_sendAckWin()
+{
+	char retryTXAck = 0;
+	bool okTX;
+	do
+	{
+		if (retryTXAck++ > _retryTXAck)
+		{
+			// maximum number of retries reached, raise error
+			
+			LOG_ERROR("ACK WIN attempt(%i/%i)", retryTXAck, _retryTXAck);
 
 			return false;
 		}
 
-		okTX = _rn.TX(
-			reinterpret_cast<char*>(&_RXRsp),
-			sizeof(_RXRsp));
-#ifdef _DEBUG_COMM_TR
-		cout << (okTX ? GREEN "[OK]" WHITE : RED "[ERROR]" WHITE);
-		printf(	" ACK(%i) attempt(%i/%i), requestResend(%i)\n", _RXRsp.SegId, retryTXAck, _retryTXAck, _RXRsp.RequestResend);
-#endif
+		okTX = _tx(_fec.Encode(_pTXBuf, EncodeRspWin(&_RXRspWin, _pTXBuf)));
+		LOG_RESULT(okTX, "ACK WIN(%i) attempt(%i/%i), mask(%08x)", _RXRspWin.SegId, retryTXAck, _retryTXAck, _RXRspWin.Mask);
 	} while (!okTX);
 
 	return true;
 }
 
+bool Comm::_repeatedEnd(size_t szRX)
+{
+	if (!_RXEnd || (Clock::Total() - _RXEndTime) / 1e6 > _toRecv())
+	{
+		return false;
+	}
+
+	if (_pRXPart->SegId)
+	{
+		return true;
+	}
+
+	// session id alone is not enough, restarted sending node may reuse it
+
+	return	_pRXInit->End &&
+		_pRXInit->Session == _RXInfo.Session &&
+		szRX == _RXInitFrame.size() &&
+		memcmp(_pRXBuf, _RXInitFrame.data(), szRX) == 0;
+}
+
+bool Comm::_sendAckEnd()
+{
+	if (!_RXInfo.Ack)
+	{
+		return true;
+	}
+
+	LOG_WARNING("RX(%i) part repeated after end, poll(%i)", _pRXPart->SegId, _pRXPart->Poll);
+
+	if (_pRXPart->Poll)
+	{
+		return _sendAckWin();
+	}
+
+	_RXRsp.RequestResend = false;
+	_RXRsp.SegId = _pRXPart->SegId;
+
+	return _sendAck();
+}
+
 bool Comm::_receive(char *pData, size_t szData)
 {
+	Trace::Span span("comm", "receive");
+
 	// reset timeout counter
 	
 	_clk.Reset();
+	double toRecv = _toRecv();
 	
 	size_t szRX;
 
@@ -848,37 +1765,49 @@ bool Comm::_receive(char *pData, size_t szData)
 	bool retryRX;
 	do
 	{
+		size_t szInfo;
 		do
 		{
-			do
-			{
-				szRX = _rn.RX(_pRXBuf, _szBufRX);
+			// without ack part packets follow each other at once, so RX is started again before
+			// packet is decoded (init packet of next message is awaited the same way)
 
-				// if timeout is reached
-				
-				double time = _clk.Now();				
-				if (time > _toRecv)
+			szInfo = _receiveInfo(&szRX, toRecv - _clk.Now(), !_RXInfo.Ack || !_RXInfo.SegId);
+
+			// last packet of completed message is repeated if its ack is lost
+
+			if (szInfo && _repeatedEnd(szRX))
+			{
+				bool okTX = _sendAckEnd();
+				if (!okTX)
 				{
-#ifdef _DEBUG_COMM_TR
-					printf(RED "[ERROR]" WHITE " RX timeout(%f/%f)\n", time, _toRecv);
-#endif
 					return false;
 				}
-			} while (szRX < sizeof(*_pRXPart));
-		} while (!_checkInfo(&_RXInfo, _pRXPart));
 
-		// determine size of info packet
-		
-		size_t szInfo;
+				szInfo = 0;
+			}
 
-		if (_pRXPart->SegId)
-		{
-			szInfo = sizeof(*_pRXPart);
-		}
-		else
+			// if timeout is reached
+			
+			double time = _clk.Now();				
+			if (!szInfo && time > toRecv)
+			{
+				_metrics.Add(METTIMEOUT);
+				LOG_ERROR("RX timeout(%f/%f)", time, toRecv);
+				return false;
+			}
+		} while (!szInfo);
+
+		// if init packet is received, start new session
+		
+		if (!_pRXPart->SegId)
 		{
-			szInfo = sizeof(*_pRXInit);
 			_RXInfo.Ack = _pRXInit->Ack;
+			_RXInfo.Window = _pRXInit->Window;
+			_RXInfo.Compress = _pRXInit->Compress;
+			_RXInfo.Stream = _pRXInit->Stream;
+			_RXInfo.Session = _RXRsp.Session = _RXRspWin.Session = _pRXInit->Session;
+			_RXInitFrame.assign(_pRXBuf, szRX);
+			_RXEnd = false;
 		}
 
 		// determine if size of received packet is ok
@@ -889,16 +1818,14 @@ bool Comm::_receive(char *pData, size_t szData)
 		
 		if (okRX)
 		{
-#ifdef _DEBUG_COMM_TR
 			if (_pRXPart->SegId)
 			{
-				printf(GREEN "[OK]" WHITE " RX(%i) part, size(%u)\n", _pRXPart->SegId, _pRXPart->Size);
+				LOG_OK("RX(%i) part, size(%u)", _pRXPart->SegId, _pRXPart->Size);
 			}
 			else
 			{
-				printf(GREEN "[OK]" WHITE " RX(%i) part, ack(%i), size(%u/%u)\n", _pRXInit->SegId, _pRXInit->Ack, _pRXInit->Size, _pRXInit->SizeTotal);
+				LOG_OK("RX(%i) part, ack(%i), size(%u/%u)", _pRXInit->SegId, _pRXInit->Ack, _pRXInit->Size, _pRXInit->SizeTotal);
 			}
-#endif
 			retryRX = false;
 
 			if (_pRXPart->Size)
@@ -920,20 +1847,18 @@ bool Comm::_receive(char *pData, size_t szData)
 		}
 		else
 		{
-#ifdef _DEBUG_COMM_TR
+			_metrics.Add(METERRSIZE);
+
 			if (_pRXPart->SegId)
 			{
-				cout << (_RXInfo.Ack ? BROWN "[WARNING]" WHITE : RED "[ERROR]" WHITE);
-				printf(	" RX(%i) part, size(%u/%u)\n",
+				LOG_RECOVERABLE(_RXInfo.Ack, "RX(%i) part, size(%u/%u)",
 					_pRXPart->SegId, _pRXPart->Size, szRX - szInfo);
 			}
 			else
 			{
-				cout << (_RXInfo.Ack ? BROWN "[WARNING]" WHITE : RED "[ERROR]" WHITE);
-				printf(	" RX(%i) part, ack(%i), size(%u/%u)\n",
+				LOG_RECOVERABLE(_RXInfo.Ack, "RX(%i) part, ack(%i), size(%u/%u)",
 					_pRXInit->SegId, _pRXInit->Ack, _pRXInit->Size, szRX - szInfo);
 			}
-#endif
 			if (_RXInfo.Ack)
 			{
 				retryRX = true;
@@ -957,53 +1882,718 @@ bool Comm::_receive(char *pData, size_t szData)
 	return true;
 }
 
-bool Comm::_checkInfo(const PacketInfo *pInfoA, const PacketInfo *pInfoB)
+bool Comm::_receiveWindow(char *pData, size_t szData, size_t szTotal)
 {
-	return	pInfoA->LocalId == pInfoB->RemoteId &&
-		pInfoA->RemoteId == pInfoB->LocalId &&
-		pInfoA->Port == pInfoB->Port;
-}
+	// part packets have segment ids from 1 to count
 
-void Comm::_releaseCrypt()
-{
-	_szRSAPvt = 0;
-	_szRSAPub = 0;
-	_szEncryptBuf = 0;
-	_szDecryptBuf = 0;
+	unsigned int count = (szTotal + _szDataMaxPart - 1) / _szDataMaxPart;
+	unsigned int base = 1;		// First segment which is not received.
+	unsigned int mask = 0;		// Bit i is set if segment base + i is received.
 
-	if (_pRSAPvt)
-	{
-		RSA_free(_pRSAPvt);
-		_pRSAPvt = NULL;
-	}
+	// reset timeout counter
+	
+	_clk.Reset();
+	double toRecv = _toRecv();
 
-	if (_pRSAPub)
-	{
-		RSA_free(_pRSAPub);
-		_pRSAPub = NULL;
-	}
+	// receive until all part packets are received
 
-	if (_pPublic)
+	while (base <= count)
 	{
-		BIO_free_all(_pPublic);
-		_pPublic = NULL;
-	}
+		size_t szRX;
+		size_t szInfo = _receiveInfo(&szRX, toRecv - _clk.Now(), true);
 
-	if (_pPrivate)
-	{
-		BIO_free_all(_pPrivate);
-		_pPrivate = NULL;
-	}
+		if (!szInfo)
+		{
+			// if timeout is reached
+			
+			double time = _clk.Now();
+			if (time > toRecv)
+			{
+				_metrics.Add(METTIMEOUT);
+				LOG_ERROR("RX WIN timeout(%f/%f)", time, toRecv);
+				return false;
+			}
 
-	if (_pEncryptBuf)
-	{
-		delete[] _pEncryptBuf;
-		_pEncryptBuf = NULL;
-	}
+			continue;
+		}
 
-	if (_pDecryptBuf)
-	{
-		delete[] _pDecryptBuf;
-		_pDecryptBuf = NULL;
+		_clk.Reset();
+
+		unsigned int seg = _pRXPart->SegId;
+		bool okRX = szRX == _pRXPart->Size + szInfo;
+
+		// init packet is repeated if its ack is lost
+
+		if (!seg)
+		{
+			_RXRsp.RequestResend = false;
+			_RXRsp.SegId = seg;
+			bool okTX = _sendAck();
+			if (!okTX)
+			{
+				return false;
+			}
+
+			continue;
+		}
+
+		// store part packet by its segment id
+
+		if (okRX && seg >= base && seg - base < _windowMax && !(mask >> (seg - base) & 1))
+		{
+			size_t offset = (seg - 1) * _szDataMaxPart;
+			if (offset < szData)
+			{
+				size_t szCopy = szData - offset > _pRXPart->Size ? _pRXPart->Size : szData - offset;
+				memcpy(pData + offset, _pRXBuf + szInfo, szCopy);
+			}
+
+			mask |= 1u << (seg - base);
+			while (mask & 1)
+			{
+				base++;
+				mask >>= 1;
+			}
+		}
+
+		if (okRX)
+		{
+			LOG_OK("RX(%i) part, size(%u), poll(%i)", _pRXPart->SegId, _pRXPart->Size, _pRXPart->Poll);
+		}
+		else
+		{
+			_metrics.Add(METERRSIZE);
+			LOG_WARNING("RX(%i) part, size(%u/%u), poll(%i)",
+				_pRXPart->SegId, _pRXPart->Size, szRX - szInfo, _pRXPart->Poll);
+		}
+
+		// reply with received segments at the end of window, last response is kept for repeated poll
+
+		_RXRspWin.SegId = base;
+		_RXRspWin.Mask = mask;
+
+		if (_pRXPart->Poll)
+		{
+			bool okTX = _sendAckWin();
+			if (!okTX)
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+bool Comm::_sendStream(istream &is, size_t *pSent)
+{
+	unsigned int window = _TXInit.Window;
+	unsigned int base = 1;		// First segment which is not acknowledged.
+	unsigned int next = 1;		// Next segment which will be read from stream.
+	unsigned int end = 0;		// Last segment of stream (0 until end of stream is read).
+	unsigned int mask = 0;		// Bit i is set if segment base + i is acknowledged.
+	unsigned int sent = 0;		// Last segment which has been sent.
+	size_t szPrev = 0;		// Size of data of previous segment sent without waiting for ack.
+
+	*pSent = 0;
+
+	unsigned char retrySend = 0;
+	while (!end || base <= end)
+	{
+		// read new segments into free slots of window, segment is last if nothing follows
+
+		while (!end && next - base < window)
+		{
+			unsigned int slot = next % _windowMax;
+			is.read(_pStreamBuf + slot * _szDataMaxPart, _szDataMaxPart);
+			_streamSz[slot] = is.gcount();
+
+			if (is.peek() == EOF)
+			{
+				end = next;
+			}
+
+			next++;
+		}
+
+		// without acknowledge segments are sent only once
+
+		if (!_TXInit.Ack)
+		{
+			for (; base < next; base++)
+			{
+				unsigned int slot = base % _windowMax;
+				_TXPart.SegId = WrapSegId(base);
+				_TXPart.Size = _streamSz[slot];
+				_TXPart.Poll = false;
+				_TXPart.End = base == end;
+
+				_waitGap(szPrev, _TXPart.Size);
+				szPrev = _TXPart.Size;
+
+				bool okTX = _transmit(&_TXPart, _pStreamBuf + slot * _szDataMaxPart, 1, false);
+				if (!okTX)
+				{
+					return false;
+				}
+
+				*pSent += _TXPart.Size;
+			}
+
+			continue;
+		}
+
+		if (retrySend++ > _retrySend)
+		{
+			// maximum number of retries without progress reached, raise error
+
+			LOG_ERROR("TX STREAM(%u-%u), attempt(%i/%i), mask(%08x)",
+				base, next - 1, retrySend, _retrySend, mask);
+
+			return false;
+		}
+
+		// poll after last segment in window which is not acknowledged
+
+		unsigned int last = base;
+		for (unsigned int seg = base; seg < next; seg++)
+		{
+			if (!(mask >> (seg - base) & 1))
+			{
+				last = seg;
+			}
+		}
+
+		Clock clk;
+		szPrev = 0;
+		for (unsigned int seg = base; seg <= last; seg++)
+		{
+			if (mask >> (seg - base) & 1)
+			{
+				continue;
+			}
+
+			unsigned int slot = seg % _windowMax;
+			_TXPart.SegId = WrapSegId(seg);
+			_TXPart.Size = _streamSz[slot];
+			_TXPart.Poll = seg == last;
+			_TXPart.End = seg == end;
+
+			if (szPrev)
+			{
+				_waitGap(szPrev, _TXPart.Size);
+			}
+			szPrev = _TXPart.Size ? _TXPart.Size : 1;
+
+			bool okTX = _transmit(&_TXPart, _pStreamBuf + slot * _szDataMaxPart, retrySend, seg <= sent);
+			if (!okTX)
+			{
+				return false;
+			}
+		}
+
+		// measure round-trip time only if polled segment is sent first time (Karn's rule)
+
+		bool first = last > sent;
+		if (first)
+		{
+			sent = last;
+		}
+
+		// reset timeout counter
+
+		_clk.Reset();
+		Trace::Span spanAck("comm", "ack window wait", last);
+
+		// wait until window response has been received or timeout occured
+
+		double time;
+		bool timeout = !_waitRsp(true, &time);
+		spanAck.End();
+
+		if (!timeout)
+		{
+			_ackRTT.Record(clk.Now());
+		}
+
+		if (timeout)
+		{
+			_pRTO->Backoff();
+		}
+		else if (first)
+		{
+			_pRTO->Sample(_clk.Now());
+		}
+		_publishRTO(timeout);
+
+		if (timeout)
+		{
+			LOG_WARNING("ACK STREAM timeout(%f), rto(%f)", time, _pRTO->Get());
+			continue;
+		}
+
+		// move window to first segment which is not received and add received segments
+
+		unsigned int segRsp = UnwrapSegId(_pRXRspWin->SegId, base);
+		unsigned int maskRsp = _pRXRspWin->Mask;
+		unsigned int baseOld = base;
+		unsigned int maskOld = mask;
+
+		if (segRsp > next)
+		{
+			segRsp = next;
+		}
+
+		if (segRsp > base)
+		{
+			mask = segRsp - base < _windowMax ? mask >> (segRsp - base) : 0;
+		}
+		else
+		{
+			maskRsp = segRsp && base - segRsp < _windowMax ? maskRsp >> (base - segRsp) : 0;
+			segRsp = base;
+		}
+
+		mask |= maskRsp & (next - segRsp < _windowMax ? (1u << (next - segRsp)) - 1 : ~0u);
+		while (mask & 1)
+		{
+			segRsp++;
+			mask >>= 1;
+		}
+
+		for (; base < segRsp; base++)
+		{
+			*pSent += _streamSz[base % _windowMax];
+		}
+
+		LOG_OK("ACK STREAM(%u) seg(%u), mask(%08x), srtt(%f), rto(%f)",
+			last, base, mask, _pRTO->GetSRTT(), _pRTO->Get());
+
+		if (base != baseOld || mask != maskOld)
+		{
+			retrySend = 0;
+		}
+	}
+
+	return true;
+}
+
+bool Comm::_receiveStream(ostream &os, size_t *pReceived)
+{
+	unsigned int base = 1;		// First segment which is not received.
+	unsigned int end = 0;		// Last segment of stream (0 until it is received).
+	unsigned int mask = 0;		// Bit i is set if segment base + i is received.
+
+	*pReceived = 0;
+
+	// reset timeout counter
+
+	_clk.Reset();
+	double toRecv = _toRecv();
+
+	// receive until all segments up to last one are received
+
+	while (!end || base <= end)
+	{
+		size_t szRX;
+		size_t szInfo = _receiveInfo(&szRX, toRecv - _clk.Now(), true);
+
+		if (!szInfo)
+		{
+			// if timeout is reached
+
+			double time = _clk.Now();
+			if (time > toRecv)
+			{
+				_metrics.Add(METTIMEOUT);
+				LOG_ERROR("RX STREAM timeout(%f/%f)", time, toRecv);
+				return false;
+			}
+
+			continue;
+		}
+
+		_clk.Reset();
+
+		bool okRX = szRX == _pRXPart->Size + szInfo;
+
+		// init packet is repeated if its ack is lost
+
+		if (!_pRXPart->SegId)
+		{
+			if (_RXInfo.Ack)
+			{
+				_RXRsp.RequestResend = false;
+				_RXRsp.SegId = 0;
+				bool okTX = _sendAck();
+				if (!okTX)
+				{
+					return false;
+				}
+			}
+
+			continue;
+		}
+
+		unsigned int seg = UnwrapSegId(_pRXPart->SegId, base);
+
+		if (okRX)
+		{
+			LOG_OK("RX STREAM(%u) part, size(%u), poll(%i), end(%i)", seg, _pRXPart->Size, _pRXPart->Poll, _pRXPart->End);
+		}
+		else
+		{
+			_metrics.Add(METERRSIZE);
+			LOG_WARNING("RX STREAM(%u) part, size(%u/%u), poll(%i)",
+				seg, _pRXPart->Size, szRX - szInfo, _pRXPart->Poll);
+		}
+
+		// without acknowledge lost or damaged segment cannot be repaired
+
+		if (!_RXInfo.Ack && (!okRX || seg != base))
+		{
+			return false;
+		}
+
+		// store segment into its slot and write all segments which are in order
+
+		if (okRX && seg >= base && seg - base < _windowMax && !(mask >> (seg - base) & 1))
+		{
+			unsigned int slot = seg % _windowMax;
+			memcpy(_pStreamBuf + slot * _szDataMaxPart, _pRXBuf + szInfo, _pRXPart->Size);
+			_streamSz[slot] = _pRXPart->Size;
+
+			if (_pRXPart->End)
+			{
+				end = seg;
+			}
+
+			mask |= 1u << (seg - base);
+			while (mask & 1)
+			{
+				slot = base % _windowMax;
+				os.write(_pStreamBuf + slot * _szDataMaxPart, _streamSz[slot]);
+				*pReceived += _streamSz[slot];
+
+				base++;
+				mask >>= 1;
+			}
+		}
+
+		// reply with received segments at the end of window, last response is kept for repeated poll
+
+		_RXRspWin.SegId = WrapSegId(base);
+		_RXRspWin.Mask = mask;
+
+		if (_RXInfo.Ack && _pRXPart->Poll)
+		{
+			bool okTX = _sendAckWin();
+			if (!okTX)
+			{
+				return false;
+			}
+		}
+	}
+
+	_RXEnd = true;
+	_RXEndTime = Clock::Total();
+
+	return os.good();
+}
+
+size_t Comm::_rx(double timeout, bool cont)
+{
+	Trace::Span span("comm", "rx");
+
+	_rn.SetContinuousRX(cont);
+
+	size_t szRX = _rn.RX(_pRXBuf, _szBufRX, timeout > 0.0 ? timeout : 0.0);
+	if (!szRX)
+	{
+		return 0;
+	}
+
+	_metrics.Add(METFRAMESRX);
+
+	Trace::Span spanFEC("comm", "fec decode", szRX);
+	size_t szData = _fec.Decode(_pRXBuf, szRX);
+	spanFEC.End();
+
+	if (!szData)
+	{
+		_metrics.Add(METERRFEC);
+		LOG_ERROR("FEC size(%u), parity(%i)", szRX, _fec.GetParity());
+	}
+	else if (_fec.GetCorrected())
+	{
+		LOG_WARNING("FEC size(%u), corrected(%i)", szRX, _fec.GetCorrected());
+	}
+
+	return szData;
+}
+
+bool Comm::_waitRsp(bool win, double *pTime)
+{
+	// responses of other sessions (late acks of previous message) are skipped
+
+	double rto = _pRTO->Get();
+	for (;;)
+	{
+		double time = _clk.Now();
+		*pTime = time;
+		if (time > rto)
+		{
+			return false;
+		}
+
+		size_t szRX = _rx(rto - time);
+		if (win ? DecodeRspWin(_pRXBuf, szRX, _pRXRspWin) && _pRXRspWin->Session == _TXInit.Session :
+			DecodeRsp(_pRXBuf, szRX, _pRXRsp) && _pRXRsp->Session == _TXInit.Session)
+		{
+			return true;
+		}
+	}
+}
+
+void Comm::_waitGap(size_t szPrev, size_t sz)
+{
+	Trace::Span span("comm", "gap");
+
+	double gap = _toGapWin + (szPrev > sz ? (szPrev - sz) * _tByteUART : 0.0);
+	usleep(static_cast<useconds_t>(gap * 1e6));
+}
+
+size_t Comm::_receiveInfo(size_t *pSzRX, double timeout, bool cont)
+{
+	size_t szRX = _rx(timeout, cont);
+	*pSzRX = szRX;
+
+	PacketType type;
+	bool okType = GetPacketType(_pRXBuf, szRX, &type);
+	if (!okType)
+	{
+		return 0;
+	}
+
+	if (type == PTINIT)
+	{
+		size_t szInfo = DecodeInit(_pRXBuf, szRX, _pRXInit);
+		return szInfo && _checkInfo(&_RXInfo, _pRXInit) ? szInfo : 0;
+	}
+	else if (type == PTPART)
+	{
+		size_t szInfo = DecodePart(_pRXBuf, szRX, _pRXPart);
+		return szInfo && _pRXPart->Session == _RXInfo.Session ? szInfo : 0;
+	}
+
+	return 0;
+}
+
+bool Comm::_checkInfo(const PacketInfo *pInfoA, const PacketInfo *pInfoB)
+{
+	return	pInfoA->LocalId == pInfoB->RemoteId &&
+		pInfoA->RemoteId == pInfoB->LocalId &&
+		pInfoA->Port == pInfoB->Port;
+}
+
+void Comm::_setAirTime(unsigned int rate)
+{
+	_air.SetBitRate(rate);
+
+	// until round-trip time is measured, expect largest frame on UART and largest response on air
+
+	_toInit = 2.0 * (_szBufTX * _tByteUART + _airtime(SZ_INFO_RSPWIN + FEC::ParityMax) + _toProc);
+	_pRTO->SetInit(_toInit);
+}
+
+void Comm::_publishRTO(bool timeout)
+{
+	if (timeout)
+	{
+		_metrics.Add(METTIMEOUT);
+	}
+
+	_metrics.Set(METSRTT, static_cast<uint32_t>(_pRTO->GetSRTT() * 1e6));
+	_metrics.Set(METRTO, static_cast<uint32_t>(_pRTO->Get() * 1e6));
+}
+
+bool Comm::_setWDT(double timeout)
+{
+	// device needs at least one step
+
+	unsigned int steps = timeout > _toWDTStep ? static_cast<unsigned int>(ceil(timeout / _toWDTStep)) : 1;
+	unsigned int wdt = static_cast<unsigned int>(steps * _toWDTStep * 1000.0 + 0.5);
+	if (wdt == _wdt)
+	{
+		return true;
+	}
+
+	bool okWDT = _rn.SetWDT(wdt);
+	if (!okWDT)
+	{
+		LOG_ERROR("WDT(%u)", wdt);
+		return false;
+	}
+
+	_wdt = wdt;
+
+	return true;
+}
+
+double Comm::_airtime(size_t sz)
+{
+	return _air.Frame(sz);
+}
+
+double Comm::_toRecv()
+{
+	return _pRTO->GetBudget(_retrySend) + _airtime(_szBufTX) + _szBufTX * _tByteUART + _toProc;
+}
+
+bool Comm::_symCrypt(bool encrypt, const unsigned char *pKey, unsigned int counter, unsigned char *pData, size_t szInfo, size_t szData, unsigned char *pTag)
+{
+	// nonce is made from message counter, it is unique for each session key
+
+	unsigned char nonce[12] = {0};
+	nonce[0] = counter;
+	nonce[1] = counter >> 8;
+	nonce[2] = counter >> 16;
+	nonce[3] = counter >> 24;
+
+	// ChaCha20-Poly1305 is used because Raspberry Zero has no AES instructions
+
+	if (EVP_CipherInit_ex(_pSymCtx, EVP_chacha20_poly1305(), NULL, pKey, nonce, encrypt) != 1)
+	{
+		return false;
+	}
+
+	if (!encrypt && EVP_CIPHER_CTX_ctrl(_pSymCtx, EVP_CTRL_AEAD_SET_TAG, _szSymTag, pTag) != 1)
+	{
+		return false;
+	}
+
+	// session info (and encrypted session key) is authenticated but not encrypted
+
+	int sz;
+	if (EVP_CipherUpdate(_pSymCtx, NULL, &sz, pData, szInfo) != 1)
+	{
+		return false;
+	}
+
+	if (szData && EVP_CipherUpdate(_pSymCtx, pData + szInfo, &sz, pData + szInfo, szData) != 1)
+	{
+		return false;
+	}
+
+	// on decrypt final verifies authentication tag
+
+	if (EVP_CipherFinal_ex(_pSymCtx, pData + szInfo + szData, &sz) != 1)
+	{
+		return false;
+	}
+
+	if (encrypt && EVP_CIPHER_CTX_ctrl(_pSymCtx, EVP_CTRL_AEAD_GET_TAG, _szSymTag, pTag) != 1)
+	{
+		return false;
+	}
+
+	return true;
+}
+
+size_t Comm::_compress(const void *pData, size_t szData)
+{
+	if (!_bCompress || szData < 2)
+	{
+		return 0;
+	}
+
+	size_t szComp = _comp.Encode(static_cast<const char*>(pData), szData, _pCompBuf, szData - 1 < _szDataMax ? szData - 1 : _szDataMax);
+
+	LOG_OK("COMPRESS size(%u), compressSize(%u)", szData, szComp);
+
+	return szComp;
+}
+
+bool Comm::_decompress(void *pData, size_t szData, size_t *pSzData)
+{
+	if (*pSzData > _szDataMax)
+	{
+		return false;
+	}
+
+	memcpy(_pCompBuf, pData, *pSzData);
+	size_t sz = _comp.Decode(_pCompBuf, *pSzData, static_cast<char*>(pData), szData);
+
+	LOG_RESULT(sz, "DECOMPRESS compressSize(%u), size(%u/%u)", *pSzData, sz, szData);
+
+	if (!sz)
+	{
+		return false;
+	}
+
+	*pSzData = sz;
+
+	return true;
+}
+
+void Comm::_releaseCrypt()
+{
+	_szRSAPvt = 0;
+	_szRSAPub = 0;
+	_szEncryptBuf = 0;
+	_szDecryptBuf = 0;
+	_szSymBuf = 0;
+	_bSymKeySent = false;
+	_bSymKeyRecv = false;
+
+	OPENSSL_cleanse(_symKeyTX, sizeof(_symKeyTX));
+	OPENSSL_cleanse(_symKeyRX, sizeof(_symKeyRX));
+
+	if (_pRSAPvt)
+	{
+		RSA_free(_pRSAPvt);
+		_pRSAPvt = NULL;
+	}
+
+	if (_pRSAPub)
+	{
+		RSA_free(_pRSAPub);
+		_pRSAPub = NULL;
+	}
+
+	if (_pPublic)
+	{
+		BIO_free_all(_pPublic);
+		_pPublic = NULL;
+	}
+
+	if (_pPrivate)
+	{
+		BIO_free_all(_pPrivate);
+		_pPrivate = NULL;
+	}
+
+	if (_pEncryptBuf)
+	{
+		delete[] _pEncryptBuf;
+		_pEncryptBuf = NULL;
+	}
+
+	if (_pDecryptBuf)
+	{
+		delete[] _pDecryptBuf;
+		_pDecryptBuf = NULL;
+	}
+
+	if (_pSymBuf)
+	{
+		delete[] _pSymBuf;
+		_pSymBuf = NULL;
+	}
+
+	if (_pSymCtx)
+	{
+		EVP_CIPHER_CTX_free(_pSymCtx);
+		_pSymCtx = NULL;
 	}
 }
@@ -1,43 +1,25 @@
 #pragma once
 
 #include <vector>
+#include <map>
+#include <iostream>
 #include <openssl/rsa.h>
 #include <openssl/pem.h>
 #include <openssl/rand.h>
+#include <openssl/evp.h>
 
+#include "airtime.h"
 #include "clock.h"
+#include "compress.h"
+#include "fec.h"
+#include "metrics.h"
+#include "packet.h"
 #include "rn2483.h"
+#include "rto.h"
 // #include "uart.h"
 
 namespace RN
 {
-	// Information for TX packet.
-	struct PacketInfo
-	{
-		unsigned char LocalId;		// Id of local (this) node.
-		unsigned char RemoteId;		// Id of remote node to which data will be send.
-		unsigned char Port;		// Port of packet.
-	};
-
-	struct PacketInfoPart : public PacketInfo
-	{
-		unsigned char Size;		// Packet data size.
-		unsigned char SegId;		// Packet segment id.
-	};
-
-	struct PacketInfoInit : public PacketInfoPart
-	{
-		bool Ack;			// Should receiving node acknowledge.
-		size_t SizeTotal;		// Total size of data (in all packets) [byte].
-	};
-
-	// Acknowledge information on TX from receiving node.
-	struct PacketInfoRsp : public PacketInfo
-	{
-		bool RequestResend;		// Packet is not received and request to resend it.
-		unsigned char SegId;		// Packet segment id.
-	};
-
 	// Class used for exchanging data through rn2483 device.
 	class Comm
 	{
@@ -50,8 +32,10 @@ namespace RN
 			~Comm();
 
 			// Initialize communication.
+			// pDevice: Pointer to path of serial device connected to RN2483.
+			// warm: Skip reset of device if it is already configured.
 			// Returns true on success, false on failure.
-			bool Init();
+			bool Init(const char *pDevice = "/dev/ttyAMA0", bool warm = false);
 
 			// Set info for sending packet.
 			// pInfo: Pointer to structure with packet information.
@@ -65,6 +49,36 @@ namespace RN
 			// Returns true on success, false on failure.
 			bool SetCrypt(const char *pPublic, const char *pPrivate);
 
+			// Set number of Reed-Solomon parity bytes appended to each packet. Damaged packet is corrected
+			// if at most half of parity bytes are damaged. Both nodes must use the same number of parity bytes.
+			// Method must be called before SetCrypt because it changes max size of data.
+			// parity: Number of parity bytes (0 to disable FEC).
+			// Returns true on success, false if number of parity bytes is too large.
+			bool SetFEC(unsigned char parity);
+
+			// Set compression of data before sending (also before encryption). Data are sent compressed
+			// only if it saves space and receiving node decompresses them according to init packet.
+			// state: Compress data if true.
+			// Returns true on success, false on failure.
+			bool SetCompress(bool state);
+
+			// Set number of part packets which are sent before waiting for acknowledge
+			// (selective repeat of lost packets). Window is used only if ack is requested.
+			// window: Number of packets in flight (1 for stop-and-wait).
+			// Returns true on success, false if window is larger than maximum.
+			bool SetWindow(unsigned char window);
+
+			// Set number of retries of packet without response before error is raised. Timeout of each
+			// retry is doubled, first timeout follows measured round-trip time of remote node.
+			// retry: Number of retries after first attempt.
+			// Returns true on success, false if number of retries is larger than maximum.
+			bool SetRetry(unsigned char retry);
+
+			// Set bit rate of radio (same on both nodes), timeouts follow air time of frames.
+			// rate: Bit rate of FSK modulation [bit/second].
+			// Returns true on success, false on failure.
+			bool SetBitRate(unsigned int rate);
+
 			// Send data through RN2483 device to specific node without receive acknowledge.
 			// pData: Pointer to data which will be send.
 			// szData: Size of data which will be send.
@@ -86,6 +100,30 @@ namespace RN
 			// Returns true on success, false on failure.
 			bool EncryptPvtSend(const void *pData, size_t szData, bool ack = true);
 
+			// Encrypt with session key and send data through RN2483 device to specific node. Session key
+			// is encrypted with public key and sent with data until it is acknowledged by receiving node,
+			// new key is sent after failed send and with every _symKeyRefresh-th message (so receiving node
+			// which lost the key recovers). Each key carries increasing epoch, so replayed older key is rejected.
+			// pData: Pointer to data which will be send.
+			// szData: Size of data which will be send.
+			// ack: Require successfull acknowledge after each TX from receiving node.
+			// Returns true on success, false on failure.
+			bool EncryptSymSend(const void *pData, size_t szData, bool ack = true);
+
+			// Acknowledge last packet of received message again while sending node repeats it because
+			// its ack is lost. Call after last message before receiving node stops receiving.
+			// Returns true on success, false on failure.
+			bool Linger();
+
+			// Send whole stream through RN2483 device to specific node in one session. Stream is split
+			// into part packets with wrapping segment ids, so its size is not limited by GetMaxSz.
+			// Part packets are sent in windows (see SetWindow) if ack is requested.
+			// is: Input stream which is read until its end.
+			// ack: Require successfull acknowledge from receiving node.
+			// pSzDataTX: Pointer to size of acknowledged (or sent without ack) data [byte].
+			// Returns true on success, false on failure.
+			bool SendStream(istream &is, bool ack = true, size_t *pSzDataTX = NULL);
+
 			// Receive data through RN2483 device from specific node.
 			// pData: Pointer where received data will be stored.
 			// szData: Size of buffer pData [byte].
@@ -107,6 +145,20 @@ namespace RN
 			// Returns true on success, false on failure.
 			bool ReceiveDecryptPvt(void *pData, size_t szData, size_t *pSzDataRX = NULL);
 
+			// Receive data through RN2483 device from specific node and decrypt it with session key. Session
+			// key is decrypted with private key when it is sent with data.
+			// pData: Pointer where received data will be stored.
+			// szData: Size of buffer pData [byte].
+			// szDataRX: Pointer to received data size [byte].
+			// Returns true on success, false on failure (also if data are not authenticated).
+			bool ReceiveDecryptSym(void *pData, size_t szData, size_t *pSzDataRX = NULL);
+
+			// Receive stream sent with SendStream and write it in order of segments.
+			// os: Output stream where received data will be written.
+			// pSzDataRX: Pointer to size of data written to os [byte].
+			// Returns true on success, false on failure.
+			bool ReceiveStream(ostream &os, size_t *pSzDataRX = NULL);
+
 			// Size of RX buffer [byte].
 			size_t GetMaxSz();
 
@@ -116,24 +168,201 @@ namespace RN
 			// Buffer for data decryption (initialized in SetCrypt method).
 			size_t GetSzDecryptBuf();
 
+			// Max size of data for session key encryption (initialized in SetCrypt method).
+			size_t GetSzSymBuf();
+
+			// Number of data packets sent again after timeout or request of receiving node (since construction).
+			size_t GetRetransmit();
+
+			// Theoretical max goodput of message limited only by air time of its frames and acks (no
+			// retransmissions, processing or UART transfer) with current radio settings, FEC and window.
+			// szData: Size of message or stream [byte].
+			// ack: Message is acknowledged.
+			// stream: Data are sent by SendStream.
+			// Returns goodput [byte/second].
+			double GetGoodputMax(size_t szData, bool ack, bool stream = false);
+
+			// Round-trip time of acks from start of TX of packet (or window) to its response (since construction).
+			const Histogram &GetAckRTT();
+
+			// Latency of sent messages and streams from start of send to last ack (since construction).
+			const Histogram &GetMsgLatency();
+
+			// Latency of TX commands of RN2483 device (since construction).
+			const Histogram &GetTXLatency();
+
+			// Publish counters (frames, retransmissions, timeouts, errors, air time, duty cycle budget and
+			// round-trip time) in POSIX shared memory segment which can be read by monitor.
+			// pName: Name of segment (e.g. /rn2483).
+			// Returns true on success, false on failure.
+			bool SetMetrics(const char *pName);
+
+			// Record every frame sent and received by RN2483 device into pcap-ng file (see Capture).
+			// pFile: Path of capture file.
+			// Returns true on success, false on failure.
+			bool SetCapture(const char *pFile);
+
+			// Log percentiles of ack round-trip time, message latency and TX latency.
+			void PrintLatency();
+
 		private:
+			// Send data through RN2483 device to specific node.
+			// pData: Pointer to data which will be send.
+			// szData: Size of data which will be send.
+			// ack: Require successfull acknowledge after each TX from receiving node.
+			// compress: Data are compressed (flag is sent in init packet).
+			// Returns true on success, false on failure.
+			bool _sendMsg(const void *pData, size_t szData, bool ack, bool compress);
+
+			// Receive data through RN2483 device from specific node without decompression.
+			// pData: Pointer where received data will be stored.
+			// szData: Size of buffer pData [byte].
+			// szDataRX: Pointer to received data size [byte].
+			// Returns true on success, false on failure.
+			bool _receiveMsg(void *pData, size_t szData, size_t *pSzDataRX);
+
+			// Compress data into _pCompBuf if compression is set.
+			// pData: Pointer to data which will be compressed.
+			// szData: Size of data [byte].
+			// Returns size of compressed data [byte] or 0 if data are not compressed (or compression does not save space).
+			size_t _compress(const void *pData, size_t szData);
+
+			// Decompress data in place (through _pCompBuf).
+			// pData: Pointer to compressed data where decompressed data will be stored.
+			// szData: Size of buffer pData [byte].
+			// pSzData: Pointer to size of compressed data which is replaced by size of decompressed data [byte].
+			// Returns true on success, false on failure.
+			bool _decompress(void *pData, size_t szData, size_t *pSzData);
+
 			// Send initial or partial data and wait for acknowledge packet if requested.
-			// pInfo: Pointer to packet info. If initial send is performed pInfo is
-			// pointing  to PacketInfoInit. If partial send is performed pInfo is
-			// pointing to PacketInfoPart.
-			// szInfo: Size of packet info at address pInfo.
+			// pInfo: Pointer to packet info. If initial send is performed (SegId is 0)
+			// pInfo is pointing to PacketInfoInit. If partial send is performed pInfo
+			// is pointing to PacketInfoPart.
 			// pData: Pointer to data which need to be send.
-			bool _send(const PacketInfoPart *pInfo, size_t szInfo, const char *pData);
+			bool _send(const PacketInfoPart *pInfo, const char *pData);
 			bool _sendAck();
 
+			// Send part packets in windows and retransmit only packets which are not acknowledged.
+			// pData: Pointer to data which need to be send after init packet.
+			// szData: Size of data [byte].
+			// Returns true on success, false on failure.
+			bool _sendWindow(const char *pData, size_t szData);
+
+			// Send part packets of stream in windows and retransmit only packets which are not acknowledged.
+			// is: Input stream which is read until its end.
+			// pSent: Pointer to size of acknowledged (or sent without ack) data [byte].
+			// Returns true on success, false on failure.
+			bool _sendStream(istream &is, size_t *pSent);
+
+			// Send acknowledge for window of part packets.
+			// Returns true on success, false on failure.
+			bool _sendAckWin();
+
+			// Is received packet repeated last packet of completed message. Repeated init packet must be
+			// same as init packet of last message and it is accepted only while sending node can retry.
+			// szRX: Size of received packet [byte].
+			bool _repeatedEnd(size_t szRX);
+
+			// Acknowledge again last packet of completed message which is repeated because its ack is lost.
+			// Returns true on success, false on failure.
+			bool _sendAckEnd();
+
+			// Encode packet info and send packet with retries on TX failure (without waiting for acknowledge).
+			// pInfo: Pointer to packet info (PacketInfoInit if SegId is 0).
+			// pData: Pointer to data which need to be send.
+			// attempt: Number of send attempt (for debug output).
+			// retransmit: Packet has been sent before (counted in METRETRANSMIT).
+			// Returns true on success, false on failure.
+			bool _transmit(const PacketInfoPart *pInfo, const char *pData, char attempt, bool retransmit);
+
+			// Send frame from _pTXBuf, watch dog timeout is raised if frame would not fit into it.
+			// szFrame: Size of frame with parity bytes [byte].
+			// Returns true on success, false on failure.
+			bool _tx(size_t szFrame);
+
 			bool _receive(char *pData, size_t szData);
 
+			// Receive packet into _pRXBuf and correct it with parity bytes.
+			// timeout: Time to wait for packet [second].
+			// cont: Keep device receiving after packet (next packet follows without response).
+			// Returns size of packet without parity bytes [byte] or 0 if no packet is received or it cannot be corrected.
+			size_t _rx(double timeout, bool cont = false);
+
+			// Wait for response of receiving node to current session until retransmission timeout (measured
+			// by _clk, which is reset before sent packet).
+			// win: Wait for window response (_pRXRspWin) instead of packet response (_pRXRsp).
+			// pTime: Pointer where time of waiting will be stored [second].
+			// Returns true if response is received, false on timeout.
+			bool _waitRsp(bool win, double *pTime);
+
+			// Wait before packet which follows previous one without response, so receiving node can read
+			// previous packet from device and start RX again before this packet is on air. Shorter packet
+			// is sent to device sooner, so the difference of UART transfer times is added.
+			// szPrev: Size of data of previous packet [byte].
+			// sz: Size of data of this packet [byte].
+			void _waitGap(size_t szPrev, size_t sz);
+
+			// Receive packet and decode its info into _RXHdr. Init packet must match
+			// LocalId, RemoteId and Port, part packet must match session of last init packet.
+			// pSzRX: Pointer where size of received packet will be stored [byte].
+			// timeout: Time to wait for packet [second].
+			// cont: Keep device receiving after packet (next packet follows without response).
+			// Returns size of packet info [byte] or 0 if no matching packet is received.
+			size_t _receiveInfo(size_t *pSzRX, double timeout, bool cont = false);
+
+			// Update bit rate of air time model and initial retransmission timeout.
+			// rate: Bit rate of radio [bit/second].
+			void _setAirTime(unsigned int rate);
+
+			// Publish round-trip time estimate of current remote node to metrics.
+			// timeout: Ack has not been received (counted as timeout).
+			void _publishRTO(bool timeout);
+
+			// Set watch dog timeout of device which limits time of RX and TX (only if it is changed).
+			// timeout: Timeout [second], it is rounded up to _toWDTStep.
+			// Returns true on success, false on failure.
+			bool _setWDT(double timeout);
+
+			// Time of frame on air.
+			// sz: Size of frame [byte].
+			// Returns time [second].
+			double _airtime(size_t sz);
+
+			// Time which receiving node waits for next packet. It lasts until sending node gives up
+			// all retries of packet (with timeouts of remote node) and sends next packet.
+			// Returns timeout [second].
+			double _toRecv();
+
+			// Receive part packets sent in windows and place them by segment id.
+			// pData: Pointer where received data will be stored.
+			// szData: Size of buffer pData [byte].
+			// szTotal: Size of data in all part packets [byte].
+			// Returns true on success, false on failure.
+			bool _receiveWindow(char *pData, size_t szData, size_t szTotal);
+
+			// Receive part packets of stream and write them in order of segments.
+			// os: Output stream where received data will be written.
+			// pReceived: Pointer to size of written data [byte].
+			// Returns true on success, false on failure.
+			bool _receiveStream(ostream &os, size_t *pReceived);
+
 			// Compare LocalId, RemoteId and Port of two packet info.
 			// pInfoA: Pointer to first packet info.
 			// pInfoB: Pointer to second packet info.
 			// Returns true if packet infos are matched or false otherwise.
 			bool _checkInfo(const PacketInfo *pInfoA, const PacketInfo *pInfoB);
 
+			// Encrypt or decrypt data in place with session key and compute or verify authentication tag.
+			// encrypt: Encrypt data if true, decrypt data otherwise.
+			// pKey: Pointer to session key.
+			// counter: Message counter from which nonce is made.
+			// pData: Pointer to message with session info (additional authenticated data) followed by data.
+			// szInfo: Size of session info [byte].
+			// szData: Size of data [byte].
+			// pTag: Pointer where authentication tag will be stored or from which it will be verified.
+			// Returns true on success, false on failure.
+			bool _symCrypt(bool encrypt, const unsigned char *pKey, unsigned int counter, unsigned char *pData, size_t szInfo, size_t szData, unsigned char *pTag);
+
 			// Release existing crypt resources.
 			void _releaseCrypt();
 
@@ -141,27 +370,51 @@ namespace RN
 
 			// RN2483 _rn;			// Communication with RN2483 device.
 			RN2483 _rn;			// Communication with RN2483 device.
-			static const char _retrySend;	// Number of attempts to send packet before error is raised.
+			unsigned char _retrySend;	// Number of retries of packet without response before error is raised.
+			static const unsigned char _retrySendMax;	// Max number of retries of packet.
 			static const char _retryTX;	// Number of attempts to send data before error is raised.
 			static const char _retryTXAck;	// Number of attempts to send ack packet before error is raised.
+			static const unsigned char _windowMax;	// Max number of part packets in flight (bits in PacketInfoRspWin::Mask).
+			unsigned char _window;		// Number of part packets in flight.
 
 			PacketInfoInit _TXInit;		// Init packet information structure on TX (for internal use).
 			PacketInfoPart _TXPart;		// Partial packet information structure on TX (for internal use).
+			unsigned char _session;		// Session id of last sent message.
+			char *_pTXBuf;			// Internal TX buffer for encoded packet (info, data and parity bytes).
+			FEC _fec;			// Forward error correction of packets.
 
 			static const size_t _szBufTX;	// Size of TX buffer [byte].
-			unsigned char _szDataMaxInit;	// Max size of data in initial TX packet [byte].
+			unsigned char _szDataMaxInit;	// Max size of data in initial TX packet with largest packet info [byte].
 			unsigned char _szDataMaxPart;	// Max size of data in partial TX packet [byte].
 			size_t _szDataMax;		// Max size of data to send regardless packet info segment limitation (PacketInfoPart::SegId is unsigned char and it cannot be greater than 255 individual messages) [byte].
 
 
-			static const double _toRecv;	// Timeout for receiving data [second].
-			static const double _toAck;	// Timeout for receiving ack packet. Afterwards data packet will be resend [second].
+			map<unsigned char, RTO> _rto;	// Retransmission timeouts of remote nodes (by RemoteId).
+			RTO *_pRTO;			// Retransmission timeout of current remote node.
+			unsigned int _wdt;		// Current watch dog timeout of device [millisecond].
+			Airtime _air;			// Air time of frames with current radio settings.
+			double _toInit;			// Retransmission timeout until round-trip time is measured [second].
+			Metrics _metrics;		// Counters published for monitoring.
+			Histogram _ackRTT;		// Round-trip time of acks.
+			Histogram _msgLatency;		// Latency of sent messages.
+			static const double _toProc;	// Processing time of command on device [second].
+			static const double _toWDTStep;	// Step of watch dog timeout [second].
+			static const double _toGapWin;	// Minimal gap between part packets sent without waiting for ack [second].
+			static const double _tByteUART;	// UART transfer time of one data byte in hex format [second].
 
 			PacketInfoInit _RXInfo;		// Init packet information structure on RX (for internal use).
 			PacketInfoRsp _RXRsp;		// Packet response which is send after successful RX (from receiving node).
+			PacketInfoRspWin _RXRspWin;	// Window response which is send after window poll (from receiving node).
+			bool _RXEnd;			// Is last message on RX completed (its repeated packets are only acknowledged).
+			double _RXEndTime;		// Time when last message on RX is completed [microsecond since epoch].
+			string _RXInitFrame;		// Init packet of last message on RX (without parity bytes).
 			static const size_t _szBufRX;	// Size of RX buffer [byte].
 			char *_pRXBuf;			// Internal RX buffer.
+			PacketInfoInit _RXHdr;		// Decoded info of last received init or part packet.
+			PacketInfoRsp _RXHdrRsp;	// Decoded info of last received response.
+			PacketInfoRspWin _RXHdrRspWin;	// Decoded info of last received window response.
 			PacketInfoRsp *_pRXRsp;		// Packet response information on TX (from receiving node).
+			PacketInfoRspWin *_pRXRspWin;	// Window response information on TX (from receiving node).
 			PacketInfoInit *_pRXInit;	// Init packet information structure on RX.
 			PacketInfoPart *_pRXPart;	// Partial packet information structure on RX.
 
@@ -178,6 +431,31 @@ namespace RN
 			size_t _szRSAPub;		// Size of RSA modulus [byte].
 			size_t _szRSAPvt;		// Maximum size of data to encrypt in one pass [byte].
 			char *_pChk;
+
+			Compressor _comp;		// Compression of data.
+			bool _bCompress;		// Compress data before sending.
+			char *_pCompBuf;		// Buffer for compressed data [_szDataMax].
+
+			char *_pStreamBuf;		// Slots of stream segments in window (indexed by segment % _windowMax).
+			unsigned char _streamSz[32];	// Size of stream segment in each slot [byte].
+
+			static const size_t _szSymKey;	// Size of session key [byte].
+			static const size_t _szSymTag;	// Size of truncated authentication tag [byte].
+			static const size_t _szSymInfo;	// Size of session info (flags and message counter) [byte].
+			static const size_t _szSymEpoch;	// Size of epoch encrypted with session key [byte].
+			static const unsigned char _symFKey;	// Flag of session info if encrypted session key follows.
+			static const unsigned int _symKeyRefresh;	// Period of messages which carry session key again.
+			EVP_CIPHER_CTX *_pSymCtx;	// Cipher context for session key encryption.
+			unsigned char *_pSymBuf;	// Buffer for message with session info, encrypted session key, data and tag.
+			size_t _szSymBuf;		// Max size of data for session key encryption.
+			unsigned char _symKeyTX[32];	// Session key on TX.
+			unsigned char _symKeyRX[32];	// Session key on RX.
+			unsigned int _symCounterTX;	// Counter of last message on TX (nonce).
+			unsigned int _symCounterRX;	// Counter of last message on RX (older messages are rejected).
+			uint64_t _symEpochTX;		// Epoch of session key on TX, time of its generation (greater than epoch of previous key) [microsecond since epoch].
+			uint64_t _symEpochRX;		// Epoch of session key on RX (keys with the same or older epoch are rejected) [microsecond since epoch].
+			bool _bSymKeySent;		// Is session key acknowledged by receiving node.
+			bool _bSymKeyRecv;		// Is session key received.
 	};
 
 };
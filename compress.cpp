@@ -0,0 +1,231 @@
+#include "compress.h"
+#include <cstring>
+
+using namespace RN;
+
+const unsigned int Compressor::_hashBits = 12;
+const size_t Compressor::_offsetMax = 65535;
+
+// Minimal length of match [byte].
+static const size_t _matchMin = 4;
+
+// Last bytes of data are always literals, match cannot start in last _limitMatch bytes (LZ4 format).
+static const size_t _lastLit = 5;
+static const size_t _limitMatch = 12;
+
+static inline unsigned int _read32(const unsigned char *ptr)
+{
+	unsigned int v;
+	memcpy(&v, ptr, sizeof(v));
+	return v;
+}
+
+Compressor::Compressor()
+{
+	static_assert(sizeof(_hash) / sizeof(_hash[0]) == 1 << 12, "hash table does not match _hashBits");
+}
+
+size_t Compressor::Encode(const char *pIn, size_t szIn, char *pOut, size_t szOut)
+{
+	const unsigned char *pSrc = reinterpret_cast<const unsigned char*>(pIn);
+	unsigned char *pDst = reinterpret_cast<unsigned char*>(pOut);
+	unsigned char *pDstEnd = pDst + szOut;
+
+	memset(_hash, 0, sizeof(_hash));
+
+	size_t anchor = 0;
+	if (szIn > _limitMatch)
+	{
+		size_t limit = szIn - _limitMatch;
+		size_t pos = 0;
+		while (pos < limit)
+		{
+			unsigned int seq = _read32(pSrc + pos);
+			unsigned int h = (seq * 2654435761U) >> (32 - _hashBits);
+			size_t ref = _hash[h];
+			_hash[h] = pos + 1;
+
+			if (!ref || pos + 1 - ref > _offsetMax || _read32(pSrc + ref - 1) != seq)
+			{
+				pos++;
+				continue;
+			}
+
+			ref--;
+
+			// extend match, last literals must stay
+
+			size_t len = _matchMin;
+			while (pos + len < szIn - _lastLit && pSrc[ref + len] == pSrc[pos + len])
+			{
+				len++;
+			}
+
+			bool okSeq = _sequence(&pDst, pDstEnd, pSrc + anchor, pos - anchor, pos - ref, len);
+			if (!okSeq)
+			{
+				return 0;
+			}
+
+			pos += len;
+			anchor = pos;
+		}
+	}
+
+	// last literals
+
+	bool okSeq = _sequence(&pDst, pDstEnd, pSrc + anchor, szIn - anchor, 0, 0);
+	if (!okSeq)
+	{
+		return 0;
+	}
+
+	return pDst - reinterpret_cast<unsigned char*>(pOut);
+}
+
+size_t Compressor::Decode(const char *pIn, size_t szIn, char *pOut, size_t szOut)
+{
+	const unsigned char *pSrc = reinterpret_cast<const unsigned char*>(pIn);
+	const unsigned char *pSrcEnd = pSrc + szIn;
+	unsigned char *pDst = reinterpret_cast<unsigned char*>(pOut);
+	unsigned char *pDstBeg = pDst;
+	unsigned char *pDstEnd = pDst + szOut;
+
+	while (pSrc < pSrcEnd)
+	{
+		unsigned char token = *pSrc++;
+
+		// literals
+
+		size_t szLit = token >> 4;
+		if (szLit == 15)
+		{
+			unsigned char b;
+			do
+			{
+				if (pSrc >= pSrcEnd)
+				{
+					return 0;
+				}
+
+				b = *pSrc++;
+				szLit += b;
+			} while (b == 255);
+		}
+
+		if (szLit > static_cast<size_t>(pSrcEnd - pSrc) || szLit > static_cast<size_t>(pDstEnd - pDst))
+		{
+			return 0;
+		}
+
+		memcpy(pDst, pSrc, szLit);
+		pSrc += szLit;
+		pDst += szLit;
+
+		// last sequence has no match
+
+		if (pSrc == pSrcEnd)
+		{
+			break;
+		}
+
+		// match
+
+		if (pSrcEnd - pSrc < 2)
+		{
+			return 0;
+		}
+
+		size_t offset = pSrc[0] | pSrc[1] << 8;
+		pSrc += 2;
+
+		if (!offset || offset > static_cast<size_t>(pDst - pDstBeg))
+		{
+			return 0;
+		}
+
+		size_t szMatch = token & 0x0F;
+		if (szMatch == 15)
+		{
+			unsigned char b;
+			do
+			{
+				if (pSrc >= pSrcEnd)
+				{
+					return 0;
+				}
+
+				b = *pSrc++;
+				szMatch += b;
+			} while (b == 255);
+		}
+		szMatch += _matchMin;
+
+		if (szMatch > static_cast<size_t>(pDstEnd - pDst))
+		{
+			return 0;
+		}
+
+		// match can overlap with output so copy byte by byte
+
+		const unsigned char *pRef = pDst - offset;
+		for (size_t i = 0; i < szMatch; i++)
+		{
+			pDst[i] = pRef[i];
+		}
+		pDst += szMatch;
+	}
+
+	return pDst - pDstBeg;
+}
+
+bool Compressor::_sequence(unsigned char **ppOut, const unsigned char *pEnd, const unsigned char *pLit, size_t szLit, size_t offset, size_t szMatch)
+{
+	unsigned char *pDst = *ppOut;
+
+	// worst case size of sequence
+
+	size_t szSeq = 1 + szLit / 255 + 1 + szLit + (offset ? 2 + (szMatch - _matchMin) / 255 + 1 : 0);
+	if (szSeq > static_cast<size_t>(pEnd - pDst))
+	{
+		return false;
+	}
+
+	unsigned char *pToken = pDst++;
+	*pToken = (szLit < 15 ? szLit : 15) << 4;
+
+	if (szLit >= 15)
+	{
+		size_t left = szLit - 15;
+		for (; left >= 255; left -= 255)
+		{
+			*pDst++ = 255;
+		}
+		*pDst++ = left;
+	}
+
+	memcpy(pDst, pLit, szLit);
+	pDst += szLit;
+
+	if (offset)
+	{
+		*pDst++ = offset;
+		*pDst++ = offset >> 8;
+
+		size_t len = szMatch - _matchMin;
+		*pToken |= len < 15 ? len : 15;
+
+		if (len >= 15)
+		{
+			for (len -= 15; len >= 255; len -= 255)
+			{
+				*pDst++ = 255;
+			}
+			*pDst++ = len;
+		}
+	}
+
+	*ppOut = pDst;
+
+	return true;
+}
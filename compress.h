@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+
+namespace RN
+{
+	// Fast LZ77 compression of messages (LZ4 block format). Compressor keeps only hash
+	// table of recent positions, decompression needs no memory besides output buffer.
+	class Compressor
+	{
+		public:
+			// Default class constructor.
+			Compressor();
+
+			// Compress data.
+			// pIn: Pointer to data which will be compressed.
+			// szIn: Size of data [byte].
+			// pOut: Pointer to buffer where compressed data will be stored.
+			// szOut: Size of buffer pOut [byte].
+			// Returns size of compressed data [byte] or 0 if compressed data do not fit into pOut.
+			size_t Encode(const char *pIn, size_t szIn, char *pOut, size_t szOut);
+
+			// Decompress data.
+			// pIn: Pointer to compressed data.
+			// szIn: Size of compressed data [byte].
+			// pOut: Pointer to buffer where decompressed data will be stored.
+			// szOut: Size of buffer pOut [byte].
+			// Returns size of decompressed data [byte] or 0 if data are damaged or do not fit into pOut.
+			size_t Decode(const char *pIn, size_t szIn, char *pOut, size_t szOut);
+
+		private:
+			// Store sequence of literals and match.
+			// ppOut: Pointer to current output position (moved after sequence).
+			// pEnd: Pointer to end of output buffer.
+			// pLit: Pointer to literals.
+			// szLit: Number of literals.
+			// offset: Distance of match (0 for last sequence without match).
+			// szMatch: Length of match [byte].
+			// Returns true on success, false if sequence does not fit.
+			bool _sequence(unsigned char **ppOut, const unsigned char *pEnd, const unsigned char *pLit, size_t szLit, size_t offset, size_t szMatch);
+
+			static const unsigned int _hashBits;	// Number of bits of hash table index.
+			static const size_t _offsetMax;		// Max distance of match [byte].
+
+			unsigned int _hash[4096];	// Last position + 1 of each hashed 4 byte sequence (0 if empty).
+	};
+};
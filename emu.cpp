@@ -0,0 +1,568 @@
+#include "emu.h"
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+
+using namespace std;
+using namespace RN;
+
+// Reply of emulated device on sys reset and sys get ver.
+static const char _VER[] = "RN2483 1.0.1 Dec 15 2015 09:38:09";
+
+// Time needed by device to restart after sys reset [second].
+static const double _tReset = 0.1;
+
+// Translate data into uppercase hex string.
+static string _hex(const string &data)
+{
+	static const char digits[] = "0123456789ABCDEF";
+
+	string hex;
+	hex.reserve(data.size() * 2);
+	for (size_t i = 0; i < data.size(); i++)
+	{
+		unsigned char c = data[i];
+		hex += digits[c >> 4];
+		hex += digits[c & 0x0F];
+	}
+
+	return hex;
+}
+
+Emu::Emu() :
+	_pLink(NULL),
+	_pPeer(NULL),
+	_fd(-1),
+	_fdSlave(-1),
+	_rx(false),
+	_tx(false),
+	_rxGen(0),
+	_uartIn(0.0),
+	_uartOut(0.0)
+{
+	_reset();
+}
+
+Emu::~Emu()
+{
+	if (!_path.empty())
+	{
+		unlink(_path.data());
+	}
+
+	if (_fdSlave != -1)
+	{
+		close(_fdSlave);
+	}
+
+	if (_fd != -1)
+	{
+		close(_fd);
+	}
+}
+
+bool Emu::Init(EmuLink *pLink, const char *pPath)
+{
+	_pLink = pLink;
+
+	_fd = posix_openpt(O_RDWR | O_NOCTTY);
+	if (_fd == -1)
+	{
+		return false;
+	}
+
+	if (grantpt(_fd) != 0 || unlockpt(_fd) != 0)
+	{
+		return false;
+	}
+
+	const char *pDev = ptsname(_fd);
+	if (!pDev)
+	{
+		return false;
+	}
+	_dev = pDev;
+
+	// keep slave open so master never reports hang up between two clients
+
+	_fdSlave = open(pDev, O_RDWR | O_NOCTTY);
+	if (_fdSlave == -1)
+	{
+		return false;
+	}
+
+	struct termios options;
+	memset(&options, 0, sizeof(options));
+	options.c_iflag = IGNPAR;
+	options.c_oflag = 0;
+	options.c_cflag = CS8 | CLOCAL | CREAD;
+	options.c_lflag = ICANON;
+	options.c_cc[VEOL] = '\n';
+	cfsetspeed(&options, B57600);
+
+	if (tcsetattr(_fdSlave, TCSANOW, &options) != 0)
+	{
+		return false;
+	}
+
+	int flags = fcntl(_fd, F_GETFL);
+	if (flags == -1 || fcntl(_fd, F_SETFL, flags | O_NONBLOCK) == -1)
+	{
+		return false;
+	}
+
+	if (pPath)
+	{
+		unlink(pPath);
+		if (symlink(pDev, pPath) != 0)
+		{
+			return false;
+		}
+		_path = pPath;
+	}
+
+	return true;
+}
+
+const char *Emu::GetDevice()
+{
+	return _dev.data();
+}
+
+double Emu::Airtime(size_t sz)
+{
+	unsigned int prlen = atoi(_set["prlen"].data());
+	bool crc = _set["crc"] == "on";
+
+	if (_set["mod"] == "fsk")
+	{
+		// preamble, sync word, length byte, payload and CRC
+
+		double rate = atof(_set["bitrate"].data());
+		size_t szSync = _set["sync"].size() / 2;
+		size_t bits = 8 * (prlen + szSync + 1 + sz + (crc ? 2 : 0));
+
+		return rate > 0.0 ? bits / rate : 0.0;
+	}
+
+	// LORA modulation (explicit header)
+
+	int sf = atoi(_set["sf"].data() + 2);
+	double bw = atof(_set["bw"].data()) * 1000.0;
+	int cr = atoi(_set["cr"].data() + 2) - 4;
+
+	double tSym = pow(2.0, sf) / bw;
+	int de = tSym > 0.016 ? 1 : 0;
+	double num = 8.0 * sz - 4.0 * sf + 28.0 + (crc ? 16.0 : 0.0);
+	double nPayload = 8.0 + fmax(ceil(num / (4.0 * (sf - 2 * de))) * (cr + 4), 0.0);
+
+	return (prlen + 4.25) * tSym + nPayload * tSym;
+}
+
+double Emu::Preamble()
+{
+	unsigned int prlen = atoi(_set["prlen"].data());
+
+	if (_set["mod"] == "fsk")
+	{
+		double rate = atof(_set["bitrate"].data());
+		return rate > 0.0 ? 8.0 * prlen / rate : 0.0;
+	}
+
+	int sf = atoi(_set["sf"].data() + 2);
+	double bw = atof(_set["bw"].data()) * 1000.0;
+
+	return (prlen + 4.25) * pow(2.0, sf) / bw;
+}
+
+void Emu::_read()
+{
+	char buf[512];
+	ssize_t szRead;
+
+	while ((szRead = read(_fd, buf, sizeof(buf))) > 0)
+	{
+		for (ssize_t i = 0; i < szRead; i++)
+		{
+			// skip break and auto-baud characters in front of command
+
+			if (_in.empty() && (buf[i] == '\0' || buf[i] == 'U'))
+			{
+				continue;
+			}
+
+			_in += buf[i];
+
+			if (buf[i] == '\n')
+			{
+				// model UART transfer time of command
+
+				double now = _pLink->_now();
+				double time = (_uartIn > now ? _uartIn : now);
+				if (_pLink->_baud)
+				{
+					time += _in.size() * 10.0 / _pLink->_baud;
+				}
+				_uartIn = time;
+
+				size_t end = _in.find_last_not_of("\r\n");
+				string line = end == string::npos ? string() : _in.substr(0, end + 1);
+				_in.clear();
+
+				_pLink->_schedule(time, [this, line, time]() { _command(line, time); });
+			}
+		}
+	}
+}
+
+void Emu::_command(const string &line, double time)
+{
+	const char *pLine = line.data();
+
+	if (line == "sys get ver")
+	{
+		_respond(_VER, time);
+	}
+	else if (line == "sys reset")
+	{
+		_reset();
+		_respond(_VER, time + _tReset);
+	}
+	else if (line == "mac pause")
+	{
+		_respond("4294967245", time);
+	}
+	else if (line == "mac resume")
+	{
+		_respond("ok", time);
+	}
+	else if (line.compare(0, 6, "radio ") == 0)
+	{
+		_radio(pLine + 6, time);
+	}
+	else
+	{
+		_respond("invalid_param", time);
+	}
+}
+
+void Emu::_radio(const char *pLine, double time)
+{
+	char key[32];
+	char value[32];
+
+	if (strncmp(pLine, "tx ", 3) == 0)
+	{
+		if (_tx || _rx)
+		{
+			_respond("busy", time);
+			return;
+		}
+
+		const char *pHex = pLine + 3;
+		size_t szHex = strlen(pHex);
+		if (szHex % 2 || szHex > 510)
+		{
+			_respond("invalid_param", time);
+			return;
+		}
+
+		string frame(szHex / 2, '\0');
+		H2D(pHex, szHex, &frame[0], frame.size());
+
+		_respond("ok", time);
+		_tx = true;
+		_pLink->_transmit(this, frame, Airtime(frame.size()));
+	}
+	else if (strncmp(pLine, "rx ", 3) == 0)
+	{
+		if (_tx || _rx)
+		{
+			_respond("busy", time);
+			return;
+		}
+
+		_respond("ok", time);
+		_arm(time);
+	}
+	else if (strcmp(pLine, "rxstop") == 0)
+	{
+		_rx = false;
+		_rxGen++;
+		_respond("ok", time);
+	}
+	else if (sscanf(pLine, "set %31s %31s", key, value) == 2)
+	{
+		if (_set.find(key) == _set.end())
+		{
+			_respond("invalid_param", time);
+			return;
+		}
+
+		_set[key] = value;
+		_respond("ok", time);
+	}
+	else if (sscanf(pLine, "get %31s", key) == 1)
+	{
+		if (_set.find(key) == _set.end())
+		{
+			_respond("invalid_param", time);
+			return;
+		}
+
+		_respond(_set[key].data(), time);
+	}
+	else
+	{
+		_respond("invalid_param", time);
+	}
+}
+
+void Emu::_reset()
+{
+	_rx = false;
+	_tx = false;
+	_rxGen++;
+
+	_set.clear();
+	_set["mod"] = "lora";
+	_set["freq"] = "868100000";
+	_set["pwr"] = "1";
+	_set["sf"] = "sf12";
+	_set["bw"] = "125";
+	_set["cr"] = "4/5";
+	_set["prlen"] = "8";
+	_set["crc"] = "on";
+	_set["iqi"] = "off";
+	_set["bitrate"] = "50000";
+	_set["fdev"] = "25000";
+	_set["bt"] = "0.5";
+	_set["rxbw"] = "25";
+	_set["afcbw"] = "41.7";
+	_set["wdt"] = "15000";
+	_set["sync"] = "34";
+}
+
+void Emu::_respond(const char *pLine, double time)
+{
+	string line(pLine);
+	line += "\r\n";
+
+	double start = _uartOut > time ? _uartOut : time;
+	double end = start;
+	if (_pLink->_baud)
+	{
+		end += line.size() * 10.0 / _pLink->_baud;
+	}
+	_uartOut = end;
+
+	int fd = _fd;
+	_pLink->_schedule(end, [fd, line]()
+	{
+		ssize_t szWrite = write(fd, line.data(), line.size());
+		(void)szWrite;
+	});
+}
+
+void Emu::_deliver(const string &frame)
+{
+	_rx = false;
+	_rxGen++;
+
+	string line("radio_rx  ");
+	line += _hex(frame);
+	_respond(line.data(), _pLink->_now());
+}
+
+void Emu::_error()
+{
+	_rx = false;
+	_rxGen++;
+	_respond("radio_err", _pLink->_now());
+}
+
+void Emu::_arm(double time)
+{
+	_rx = true;
+	unsigned int gen = ++_rxGen;
+
+	// raise radio_err if nothing is received before watch dog timeout
+
+	unsigned int wdt = atoi(_set["wdt"].data());
+	if (wdt)
+	{
+		_pLink->_schedule(time + wdt / 1000.0, [this, gen]()
+		{
+			if (_rx && _rxGen == gen)
+			{
+				_error();
+			}
+		});
+	}
+}
+
+EmuLink::EmuLink() :
+	_baud(57600),
+	_idEvent(0)
+{
+}
+
+bool EmuLink::Init(const char *pPath0, const char *pPath1)
+{
+	if (!_dev[0].Init(this, pPath0) || !_dev[1].Init(this, pPath1))
+	{
+		return false;
+	}
+
+	_dev[0]._pPeer = &_dev[1];
+	_dev[1]._pPeer = &_dev[0];
+
+	return true;
+}
+
+void EmuLink::SetBaud(unsigned int baud)
+{
+	_baud = baud;
+}
+
+bool EmuLink::SetChannel(const ChannelParam *pParam)
+{
+	ChannelParam param = *pParam;
+
+	for (int i = 0; i < 2; i++, param.Seed++)
+	{
+		if (!_ch[i].SetParam(&param))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void EmuLink::PrintStats()
+{
+	_ch[0].PrintStats("0 -> 1");
+	_ch[1].PrintStats("1 -> 0");
+}
+
+Emu *EmuLink::GetDevice(int idx)
+{
+	return &_dev[idx];
+}
+
+void EmuLink::Run(volatile bool *pStop)
+{
+	struct pollfd fds[2];
+	fds[0].fd = _dev[0]._fd;
+	fds[1].fd = _dev[1]._fd;
+
+	while (!(pStop && *pStop))
+	{
+		// execute all events which are due
+
+		while (!_events.empty() && _events.top().Time <= _now())
+		{
+			function<void()> action = _events.top().Action;
+			_events.pop();
+			action();
+		}
+
+		// wait for commands until next event (but check stop flag regularly)
+
+		int timeout = 100;
+		if (!_events.empty())
+		{
+			double wait = (_events.top().Time - _now()) * 1000.0;
+			timeout = wait < 0.0 ? 0 : (wait < timeout ? static_cast<int>(ceil(wait)) : timeout);
+		}
+
+		fds[0].events = fds[1].events = POLLIN;
+		int rc = poll(fds, 2, timeout);
+		if (rc == -1 && errno != EINTR)
+		{
+			return;
+		}
+
+		for (int i = 0; i < 2; i++)
+		{
+			if (fds[i].revents & POLLIN)
+			{
+				_dev[i]._read();
+			}
+		}
+	}
+}
+
+void EmuLink::_schedule(double time, function<void()> action)
+{
+	Event e;
+	e.Time = time;
+	e.Id = _idEvent++;
+	e.Action = action;
+	_events.push(e);
+}
+
+void EmuLink::_transmit(Emu *pFrom, const string &frame, double airtime)
+{
+	Emu *pTo = pFrom->_pPeer;
+
+	// frame is heard only if receiver is listening before first half of preamble is gone
+
+	struct Lock
+	{
+		bool Heard;
+		unsigned int Gen;
+	};
+	shared_ptr<Lock> pLock(new Lock());
+	pLock->Heard = false;
+
+	double start = _now();
+	_schedule(start + pFrom->Preamble() / 2.0, [pTo, pLock]()
+	{
+		pLock->Heard = pTo->_rx && !pTo->_tx;
+		pLock->Gen = pTo->_rxGen;
+	});
+
+	Channel *pCh = &_ch[pFrom - _dev];
+
+	_schedule(start + airtime, [this, pFrom, pTo, pCh, frame, pLock]()
+	{
+		pFrom->_tx = false;
+		pFrom->_respond("radio_tx_ok", _now());
+
+		// fate of frame is drawn even if it is not heard so impairments depend only on number of frames
+
+		string rx(frame);
+		ChannelFate fate = pCh->Pass(&rx);
+
+		if (!(pLock->Heard && pTo->_rx && pTo->_rxGen == pLock->Gen) || fate == CFLOST)
+		{
+			return;
+		}
+
+		// corrupted frame is dropped by device with radio_err if CRC is on
+
+		if (fate == CFERR || (fate == CFCORRUPT && pTo->_set["crc"] == "on"))
+		{
+			pTo->_error();
+			return;
+		}
+
+		// receiver stays in RX until delayed frame is delivered
+
+		unsigned int gen = pLock->Gen;
+		_schedule(_now() + pCh->GetLatency(), [pTo, rx, gen]()
+		{
+			if (pTo->_rx && pTo->_rxGen == gen)
+			{
+				pTo->_deliver(rx);
+			}
+		});
+	});
+}
+
+double EmuLink::_now()
+{
+	return _clk.Now();
+}
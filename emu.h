@@ -0,0 +1,179 @@
+#pragma once
+
+#include <string>
+#include <map>
+#include <queue>
+#include <vector>
+#include <functional>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+
+#include "channel.h"
+#include "clock.h"
+#include "tools.h"
+
+using namespace std;
+
+namespace RN
+{
+	class EmuLink;
+
+	// Emulated RN2483 device which exposes pseudo-terminal and speaks subset of
+	// RN2483 command set used by RN2483 class.
+	class Emu
+	{
+		friend class EmuLink;
+
+		public:
+			// Default class constructor.
+			Emu();
+
+			// Class destructor.
+			// Close pseudo-terminal and release all resources.
+			~Emu();
+
+			// Open pseudo-terminal for emulated device.
+			// pLink: Pointer to link which schedules events of device.
+			// pPath: Pointer to path of symbolic link which will point to pseudo-terminal (NULL to skip).
+			// Returns true on success, false on failure.
+			bool Init(EmuLink *pLink, const char *pPath);
+
+			// Name of pseudo-terminal slave device which should be opened by RN2483 class.
+			const char *GetDevice();
+
+			// Airtime of frame with current radio settings.
+			// sz: Size of frame payload [byte].
+			// Returns airtime [second].
+			double Airtime(size_t sz);
+
+			// Duration of preamble with current radio settings.
+			// Returns preamble duration [second].
+			double Preamble();
+
+		private:
+			// Read data from pseudo-terminal and process complete command lines.
+			void _read();
+
+			// Process one command line (without CR LF).
+			// line: Command line.
+			// time: Time when command is completely received [second].
+			void _command(const string &line, double time);
+
+			// Process radio commands.
+			// pLine: Pointer to null-terminated command line without "radio " prefix.
+			// time: Time when command is completely received [second].
+			void _radio(const char *pLine, double time);
+
+			// Reset radio settings to default values.
+			void _reset();
+
+			// Queue response line which will be written after UART transfer time.
+			// pLine: Pointer to null-terminated response without CR LF.
+			// time: Time after which response is started [second].
+			void _respond(const char *pLine, double time);
+
+			// Deliver frame received from air.
+			// frame: Received frame data.
+			void _deliver(const string &frame);
+
+			// Stop receiving and report radio_err.
+			void _error();
+
+			// Set state of device to receiving.
+			// time: Time when receiving starts [second].
+			void _arm(double time);
+
+			EmuLink *_pLink;		// Link which schedules events.
+			Emu *_pPeer;			// Device on the other side of link.
+
+			int _fd;			// File descriptor of pseudo-terminal master.
+			int _fdSlave;			// File descriptor of pseudo-terminal slave (kept open while emulator runs).
+			string _dev;			// Name of pseudo-terminal slave device.
+			string _path;			// Symbolic link to slave device.
+			string _in;			// Partially received command line.
+
+			map<string, string> _set;	// Radio settings.
+
+			bool _rx;			// Device is in receive mode.
+			bool _tx;			// Device is transmitting.
+			unsigned int _rxGen;		// Generation of receive mode (used to cancel watch dog timeout).
+			double _uartIn;			// Time when UART input will be free [second].
+			double _uartOut;		// Time when UART output will be free [second].
+	};
+
+	// Link between two emulated RN2483 devices. Link owns event loop which models
+	// UART transfer time and airtime of frames.
+	class EmuLink
+	{
+		friend class Emu;
+
+		public:
+			// Default class constructor.
+			EmuLink();
+
+			// Open pseudo-terminals for both devices.
+			// pPath0: Pointer to path of symbolic link for first device (NULL to skip).
+			// pPath1: Pointer to path of symbolic link for second device (NULL to skip).
+			// Returns true on success, false on failure.
+			bool Init(const char *pPath0, const char *pPath1);
+
+			// Set UART baud rate used for modelling transfer time (0 to disable).
+			// baud: UART baud rate [bps].
+			void SetBaud(unsigned int baud);
+
+			// Set impairments of channel in both directions. Direction from second device
+			// uses seed increased by one.
+			// pParam: Pointer to channel parameters.
+			// Returns true on success, false if parameters are invalid.
+			bool SetChannel(const ChannelParam *pParam);
+
+			// Get emulated device.
+			// idx: Index of device (0 or 1).
+			Emu *GetDevice(int idx);
+
+			// Print statistics of channel in both directions.
+			void PrintStats();
+
+			// Process events until *pStop is set.
+			// pStop: Pointer to stop flag (NULL to run forever).
+			void Run(volatile bool *pStop = NULL);
+
+		private:
+			// Event which will be executed at specific time.
+			struct Event
+			{
+				double Time;			// Time of event [second].
+				unsigned long Id;		// Sequence number which keeps order of events at same time.
+				function<void()> Action;	// Action executed at event time.
+
+				bool operator>(const Event &e) const
+				{
+					return Time > e.Time || (Time == e.Time && Id > e.Id);
+				}
+			};
+
+			// Schedule event.
+			// time: Time of event [second].
+			// action: Action which will be executed.
+			void _schedule(double time, function<void()> action);
+
+			// Transmit frame from device through air.
+			// pFrom: Pointer to transmitting device.
+			// frame: Transmitted frame data.
+			// airtime: Airtime of frame [second].
+			void _transmit(Emu *pFrom, const string &frame, double airtime);
+
+			// Current time [second].
+			double _now();
+
+			Clock _clk;			// Time base of link.
+			Emu _dev[2];			// Linked devices.
+			Channel _ch[2];			// Channel from device with same index to its peer.
+			unsigned int _baud;		// UART baud rate [bps].
+			unsigned long _idEvent;		// Sequence number of last event.
+			priority_queue<Event, vector<Event>, greater<Event> > _events;	// Pending events.
+	};
+};
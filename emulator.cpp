@@ -0,0 +1,84 @@
+#include <boost/program_options.hpp>
+#include <string>
+#include <iostream>
+#include <signal.h>
+
+#include "emu.h"
+
+using namespace std;
+using namespace RN;
+namespace po = boost::program_options;
+
+static volatile bool _stop = false;
+
+static void on_signal(int)
+{
+	_stop = true;
+}
+
+int main(int argc, char **argv)
+{
+	po::options_description desc;
+	desc.add_options()
+		("help,h", "Help screen")
+		("dev0", po::value<string>()->default_value("/tmp/rn2483-0"), "Symbolic link to pseudo-terminal of first emulated device")
+		("dev1", po::value<string>()->default_value("/tmp/rn2483-1"), "Symbolic link to pseudo-terminal of second emulated device")
+		("baud", po::value<unsigned int>()->default_value(57600), "UART baud rate used for transfer time (0 to disable)")
+		("seed", po::value<unsigned int>()->default_value(1), "Seed of channel impairments")
+		("loss", po::value<double>()->default_value(0.0), "Probability of frame loss (in good state of Gilbert-Elliott model)")
+		("lossbad", po::value<double>()->default_value(1.0), "Probability of frame loss in bad state of Gilbert-Elliott model")
+		("gb", po::value<double>()->default_value(0.0), "Probability of transition from good to bad state (0 for i.i.d. loss)")
+		("bg", po::value<double>()->default_value(1.0), "Probability of transition from bad to good state")
+		("ber", po::value<double>()->default_value(0.0), "Bit error rate of received frames")
+		("radioerr", po::value<double>()->default_value(0.0), "Probability of radio_err instead of received frame")
+		("latency", po::value<double>()->default_value(0.0), "Extra latency of frame delivery [second]");
+
+	po::variables_map vm;
+	po::store(po::parse_command_line(argc, argv, desc), vm);
+	po::notify(vm);
+
+	if (vm.count("help"))
+	{
+		cout << desc << "\n";
+		return 0;
+	}
+
+	EmuLink link;
+	link.SetBaud(vm["baud"].as<unsigned int>());
+
+	ChannelParam param;
+	param.Seed = vm["seed"].as<unsigned int>();
+	param.Loss = vm["loss"].as<double>();
+	param.LossBad = vm["lossbad"].as<double>();
+	param.GoodToBad = vm["gb"].as<double>();
+	param.BadToGood = vm["bg"].as<double>();
+	param.BitError = vm["ber"].as<double>();
+	param.RadioErr = vm["radioerr"].as<double>();
+	param.Latency = vm["latency"].as<double>();
+
+	bool okChannel = link.SetChannel(&param);
+	if (!okChannel)
+	{
+		cerr << "Invalid channel parameters\n";
+		return -1;
+	}
+
+	bool okInit = link.Init(vm["dev0"].as<string>().data(), vm["dev1"].as<string>().data());
+	if (!okInit)
+	{
+		cerr << "Unable to open pseudo-terminals\n";
+		return -1;
+	}
+
+	printf("%s -> %s\n", vm["dev0"].as<string>().data(), link.GetDevice(0)->GetDevice());
+	printf("%s -> %s\n", vm["dev1"].as<string>().data(), link.GetDevice(1)->GetDevice());
+	fflush(stdout);
+
+	signal(SIGINT, on_signal);
+	signal(SIGTERM, on_signal);
+
+	link.Run(&_stop);
+	link.PrintStats();
+
+	return 0;
+}
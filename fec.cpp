@@ -0,0 +1,254 @@
+#include "fec.h"
+#include <cstring>
+
+using namespace RN;
+
+const unsigned char FEC::ParityMax = 32;
+
+FEC::FEC() :
+	_parity(0),
+	_corrected(0)
+{
+	static_assert(sizeof(_gen) > ParityMax, "generator polynomial does not fit");
+
+	// GF(256) with primitive polynomial x^8 + x^4 + x^3 + x^2 + 1
+
+	unsigned int x = 1;
+	for (int i = 0; i < 255; i++)
+	{
+		_exp[i] = _exp[i + 255] = x;
+		_log[x] = i;
+		x <<= 1;
+		if (x & 0x100)
+		{
+			x ^= 0x11D;
+		}
+	}
+	_exp[510] = _exp[511] = _exp[0];
+	_log[0] = 0;
+
+	memset(_gen, 0, sizeof(_gen));
+	_gen[0] = 1;
+}
+
+bool FEC::SetParity(unsigned char parity)
+{
+	if (parity > ParityMax)
+	{
+		return false;
+	}
+
+	// generator polynomial (x - a^0)(x - a^1)...(x - a^(parity - 1))
+
+	memset(_gen, 0, sizeof(_gen));
+	_gen[0] = 1;
+	for (unsigned char j = 0; j < parity; j++)
+	{
+		for (int i = j + 1; i > 0; i--)
+		{
+			_gen[i] ^= _mul(_gen[i - 1], _exp[j]);
+		}
+	}
+
+	_parity = parity;
+
+	return true;
+}
+
+unsigned char FEC::GetParity() { return _parity; }
+
+unsigned char FEC::GetCorrected() { return _corrected; }
+
+size_t FEC::Encode(char *pBuf, size_t sz)
+{
+	if (!_parity)
+	{
+		return sz;
+	}
+
+	unsigned char *ptr = reinterpret_cast<unsigned char*>(pBuf);
+	unsigned char *pParity = ptr + sz;
+
+	// remainder of division of frame by generator polynomial
+
+	memset(pParity, 0, _parity);
+	for (size_t i = 0; i < sz; i++)
+	{
+		unsigned char fb = ptr[i] ^ pParity[0];
+		memmove(pParity, pParity + 1, _parity - 1);
+		pParity[_parity - 1] = 0;
+
+		if (fb)
+		{
+			for (unsigned char j = 0; j < _parity; j++)
+			{
+				pParity[j] ^= _mul(_gen[j + 1], fb);
+			}
+		}
+	}
+
+	return sz + _parity;
+}
+
+size_t FEC::Decode(char *pBuf, size_t sz)
+{
+	_corrected = 0;
+
+	if (sz <= _parity || sz > 255)
+	{
+		return 0;
+	}
+
+	if (!_parity)
+	{
+		return sz;
+	}
+
+	unsigned char *ptr = reinterpret_cast<unsigned char*>(pBuf);
+
+	// syndromes S(j) = c(a^j), byte i is coefficient of x^(sz - 1 - i)
+
+	unsigned char synd[ParityMax];
+	bool ok = true;
+	for (unsigned char j = 0; j < _parity; j++)
+	{
+		unsigned char s = 0;
+		for (size_t i = 0; i < sz; i++)
+		{
+			s = _mul(s, _exp[j]) ^ ptr[i];
+		}
+
+		synd[j] = s;
+		ok = ok && !s;
+	}
+
+	if (ok)
+	{
+		return sz - _parity;
+	}
+
+	// error locator polynomial with Berlekamp-Massey algorithm (lowest degree first)
+
+	unsigned char loc[ParityMax + 1] = {1};
+	unsigned char prev[ParityMax + 1] = {1};
+	unsigned char tmp[ParityMax + 1];
+	unsigned int nLoc = 0;
+	unsigned int shift = 1;
+	unsigned char b = 1;
+
+	for (unsigned char r = 0; r < _parity; r++)
+	{
+		unsigned char d = synd[r];
+		for (unsigned int i = 1; i <= nLoc; i++)
+		{
+			d ^= _mul(loc[i], synd[r - i]);
+		}
+
+		if (!d)
+		{
+			shift++;
+			continue;
+		}
+
+		unsigned char coef = _div(d, b);
+		memcpy(tmp, loc, sizeof(loc));
+
+		for (unsigned int i = 0; i + shift <= _parity; i++)
+		{
+			loc[i + shift] ^= _mul(coef, prev[i]);
+		}
+
+		if (2 * nLoc <= r)
+		{
+			nLoc = r + 1 - nLoc;
+			memcpy(prev, tmp, sizeof(prev));
+			b = d;
+			shift = 1;
+		}
+		else
+		{
+			shift++;
+		}
+	}
+
+	if (2 * nLoc > _parity)
+	{
+		return 0;
+	}
+
+	// error evaluator polynomial O(x) = S(x) L(x) mod x^parity
+
+	unsigned char eval[ParityMax];
+	for (unsigned char i = 0; i < _parity; i++)
+	{
+		unsigned char e = 0;
+		for (unsigned int j = 0; j <= i && j <= nLoc; j++)
+		{
+			e ^= _mul(loc[j], synd[i - j]);
+		}
+		eval[i] = e;
+	}
+
+	// find roots of error locator (Chien search) and error values (Forney algorithm)
+
+	unsigned int found = 0;
+	for (size_t pos = 0; pos < sz; pos++)
+	{
+		// X = a^pos, evaluate polynomials in X^-1
+
+		unsigned char xInv = _exp[(255 - pos % 255) % 255];
+
+		unsigned char l = 0;
+		unsigned char lDer = 0;
+		unsigned char xPow = 1;
+		for (unsigned int i = 0; i <= nLoc; i++)
+		{
+			l ^= _mul(loc[i], xPow);
+			if (i & 1)
+			{
+				lDer ^= _mul(loc[i], _div(xPow, xInv));
+			}
+			xPow = _mul(xPow, xInv);
+		}
+
+		if (l)
+		{
+			continue;
+		}
+
+		unsigned char o = 0;
+		xPow = 1;
+		for (unsigned char i = 0; i < _parity; i++)
+		{
+			o ^= _mul(eval[i], xPow);
+			xPow = _mul(xPow, xInv);
+		}
+
+		if (!lDer)
+		{
+			return 0;
+		}
+
+		ptr[sz - 1 - pos] ^= _mul(_exp[pos % 255], _div(o, lDer));
+		found++;
+	}
+
+	if (found != nLoc)
+	{
+		return 0;
+	}
+
+	_corrected = found;
+
+	return sz - _parity;
+}
+
+unsigned char FEC::_mul(unsigned char a, unsigned char b)
+{
+	return a && b ? _exp[_log[a] + _log[b]] : 0;
+}
+
+unsigned char FEC::_div(unsigned char a, unsigned char b)
+{
+	return a ? _exp[_log[a] + 255 - _log[b]] : 0;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+
+namespace RN
+{
+	// Reed-Solomon code over GF(256) used for forward error correction of radio frames.
+	// Parity bytes are appended to frame, decoder corrects up to parity / 2 damaged bytes.
+	class FEC
+	{
+		public:
+			// Default class constructor (no parity bytes).
+			FEC();
+
+			// Set number of parity bytes appended to frame.
+			// parity: Number of parity bytes (0 to disable FEC).
+			// Returns true on success, false if number of parity bytes is larger than maximum.
+			bool SetParity(unsigned char parity);
+
+			// Number of parity bytes appended to frame.
+			unsigned char GetParity();
+
+			// Append parity bytes to frame.
+			// pBuf: Pointer to frame, buffer must be large enough for parity bytes.
+			// sz: Size of frame [byte].
+			// Returns size of frame with parity bytes [byte].
+			size_t Encode(char *pBuf, size_t sz);
+
+			// Correct frame in place and remove parity bytes.
+			// pBuf: Pointer to received frame with parity bytes.
+			// sz: Size of received frame [byte].
+			// Returns size of corrected frame without parity bytes [byte] or 0 if frame cannot be corrected.
+			size_t Decode(char *pBuf, size_t sz);
+
+			// Number of bytes corrected by last Decode.
+			unsigned char GetCorrected();
+
+			static const unsigned char ParityMax;	// Max number of parity bytes.
+
+		private:
+			// Multiply two elements of GF(256).
+			unsigned char _mul(unsigned char a, unsigned char b);
+
+			// Divide two elements of GF(256) (b must not be 0).
+			unsigned char _div(unsigned char a, unsigned char b);
+
+			unsigned char _exp[512];	// Powers of generator element (doubled to avoid modulo).
+			unsigned char _log[256];	// Logarithms of elements.
+			unsigned char _gen[33];		// Generator polynomial (highest degree first).
+			unsigned char _parity;		// Number of parity bytes.
+			unsigned char _corrected;	// Number of bytes corrected by last Decode.
+	};
+};
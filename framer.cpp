@@ -0,0 +1,113 @@
+#include "framer.h"
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+
+using namespace RN;
+
+const size_t Framer::LineMax = 1024;
+const size_t Framer::_szRing = 4096;
+
+Framer::Framer() :
+	_pBuf(new char[_szRing + LineMax + 1]),
+	_head(0),
+	_tail(0),
+	_scan(0)
+{
+}
+
+Framer::~Framer()
+{
+	delete[] _pBuf;
+}
+
+bool Framer::Fill(int fd)
+{
+	while (_tail - _head < _szRing)
+	{
+		// read into contiguous free space up to end of ring
+
+		size_t idx = _tail % _szRing;
+		size_t free = _szRing - (_tail - _head);
+		size_t szRead = free < _szRing - idx ? free : _szRing - idx;
+
+		ssize_t rc = read(fd, _pBuf + idx, szRead);
+		if (rc < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+
+			return errno == EAGAIN;
+		}
+
+		_tail += rc;
+		if (static_cast<size_t>(rc) < szRead)
+		{
+			break;
+		}
+	}
+
+	return true;
+}
+
+char *Framer::Next(size_t *pSz)
+{
+	while (true)
+	{
+		// find line ending in bytes which have not been searched yet
+
+		size_t end = _scan;
+		while (end < _tail && _pBuf[end % _szRing] != '\n')
+		{
+			end++;
+		}
+		_scan = end;
+
+		size_t szLine = end - _head + 1;
+		if (end == _tail)
+		{
+			// line which does not fit is dropped so buffer cannot stay full
+
+			if (_tail - _head >= LineMax)
+			{
+				_head = _scan = _tail;
+			}
+
+			return NULL;
+		}
+
+		size_t head = _head;
+		_head = _scan = end + 1;
+
+		if (szLine > LineMax)
+		{
+			continue;
+		}
+
+		// copy beginning of ring behind its end if line wraps
+
+		size_t idx = head % _szRing;
+		if (idx + szLine > _szRing)
+		{
+			memcpy(_pBuf + _szRing, _pBuf, idx + szLine - _szRing);
+		}
+
+		char *pLine = _pBuf + idx;
+		size_t sz = szLine - 1;
+		if (sz && pLine[sz - 1] == '\r')
+		{
+			sz--;
+		}
+		pLine[sz] = '\0';
+
+		*pSz = sz;
+		return pLine;
+	}
+}
+
+void Framer::Clear()
+{
+	_head = _tail = _scan = 0;
+}
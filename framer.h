@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+
+namespace RN
+{
+	// Ring buffer which owns all bytes read from UART and splits them into lines ending with
+	// LF (or CR LF). Line is returned in place as null-terminated string without line ending,
+	// only line which wraps around end of ring is copied behind it to stay contiguous.
+	class Framer
+	{
+		public:
+			// Default class constructor.
+			Framer();
+
+			// Class destructor.
+			~Framer();
+
+			// Read all bytes which are available on descriptor (without waiting).
+			// fd: Non-blocking file descriptor.
+			// Returns true on success (also if no byte is available), false on failure.
+			bool Fill(int fd);
+
+			// Take next complete line from buffer.
+			// pSz: Pointer where size of line without line ending will be stored [byte].
+			// Returns pointer to line (valid until next Fill) or NULL if no complete line is buffered.
+			char *Next(size_t *pSz);
+
+			// Drop all buffered bytes.
+			void Clear();
+
+			static const size_t LineMax;	// Max size of line with line ending [byte], longer lines are dropped.
+
+		private:
+			static const size_t _szRing;	// Size of ring [byte].
+
+			char *_pBuf;		// Ring followed by area for wrapped lines.
+			size_t _head;		// Position of first byte of next line (positions grow, index is position % _szRing).
+			size_t _tail;		// Position behind last byte read from descriptor.
+			size_t _scan;		// Position from which line ending has not been searched yet.
+	};
+};
@@ -0,0 +1,101 @@
+#include "histogram.h"
+#include <cstring>
+
+#include "log.h"
+
+using namespace RN;
+
+const unsigned int Histogram::_subBits;
+const unsigned int Histogram::_maxBits;
+const size_t Histogram::_szCounts;
+
+Histogram::Histogram()
+{
+	Reset();
+}
+
+void Histogram::Record(double value)
+{
+	uint64_t us = value > 0.0 ? static_cast<uint64_t>(value * 1e6) : 0;
+	if (us >= (static_cast<uint64_t>(1) << _maxBits))
+	{
+		us = (static_cast<uint64_t>(1) << _maxBits) - 1;
+	}
+
+	_counts[_bucket(us)]++;
+	_count++;
+
+	if (us > _max)
+	{
+		_max = us;
+	}
+}
+
+void Histogram::Reset()
+{
+	memset(_counts, 0, sizeof(_counts));
+	_count = 0;
+	_max = 0;
+}
+
+size_t Histogram::GetCount() const
+{
+	return _count;
+}
+
+double Histogram::GetPercentile(double p) const
+{
+	if (!_count)
+	{
+		return 0.0;
+	}
+
+	// rank of value at percentile, at least first value
+
+	size_t rank = static_cast<size_t>(p / 100.0 * _count + 0.5);
+	rank = rank ? rank : 1;
+	rank = rank < _count ? rank : _count;
+
+	size_t sum = 0;
+	for (size_t i = 0; i < _szCounts; i++)
+	{
+		sum += _counts[i];
+		if (sum >= rank)
+		{
+			uint64_t us = _highest(i);
+			return (us < _max ? us : _max) / 1e6;
+		}
+	}
+
+	return _max / 1e6;
+}
+
+double Histogram::GetMax() const
+{
+	return _max / 1e6;
+}
+
+void Histogram::Print(const char *pName) const
+{
+	LOG_OK("LATENCY %s count(%zu), p50(%f), p90(%f), p99(%f), max(%f)",
+		pName, _count, GetPercentile(50.0), GetPercentile(90.0), GetPercentile(99.0), GetMax());
+}
+
+size_t Histogram::_bucket(uint64_t value)
+{
+	// values below 2^_subBits have own bucket, larger are shifted so their top _subBits bits remain
+
+	unsigned int msb = 63 - __builtin_clzll(value | 1);
+	unsigned int shift = msb < _subBits ? 0 : msb - _subBits + 1;
+
+	return (static_cast<size_t>(shift) << (_subBits - 1)) + (value >> shift);
+}
+
+uint64_t Histogram::_highest(size_t bucket)
+{
+	size_t half = static_cast<size_t>(1) << (_subBits - 1);
+	unsigned int shift = bucket < 2 * half ? 0 : bucket / half - 1;
+	uint64_t mantissa = bucket - (static_cast<size_t>(shift) << (_subBits - 1));
+
+	return ((mantissa + 1) << shift) - 1;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace RN
+{
+	// Histogram of latencies with logarithmic buckets (HDR style). Values are counted in microseconds,
+	// each power of two is split into 32 linear buckets, so reported percentiles are within 1/32 of
+	// recorded values (exact below 64 microseconds). Memory and time of Record do not depend on number
+	// of recorded values.
+	class Histogram
+	{
+		public:
+			// Default class constructor.
+			Histogram();
+
+			// Add value.
+			// value: Latency [second].
+			void Record(double value);
+
+			// Remove all values.
+			void Reset();
+
+			// Number of recorded values.
+			// Returns number of values.
+			size_t GetCount() const;
+
+			// Value below which given percentage of recorded values falls.
+			// p: Percentile (0 to 100).
+			// Returns highest value of bucket which contains percentile [second], 0 if histogram is empty.
+			double GetPercentile(double p) const;
+
+			// Maximum recorded value.
+			// Returns latency [second].
+			double GetMax() const;
+
+			// Log count, p50, p90, p99 and max.
+			// pName: Name of histogram.
+			void Print(const char *pName) const;
+
+		private:
+			// Bucket which contains value.
+			// value: Latency [microsecond].
+			// Returns index of bucket.
+			static size_t _bucket(uint64_t value);
+
+			// Highest value of bucket.
+			// bucket: Index of bucket.
+			// Returns latency [microsecond].
+			static uint64_t _highest(size_t bucket);
+
+			static const unsigned int _subBits = 6;	// Bits of value kept in each power of two (plus one).
+			static const unsigned int _maxBits = 40;	// Bits of largest value (larger values are clipped).
+			static const size_t _szCounts = (_maxBits - _subBits + 2) << (_subBits - 1);	// Number of buckets.
+
+			size_t _counts[_szCounts];		// Counts of buckets.
+			size_t _count;				// Number of values.
+			uint64_t _max;				// Maximum value [microsecond].
+	};
+};
@@ -0,0 +1,310 @@
+#include "log.h"
+#include <cstdio>
+#include <unistd.h>
+
+using namespace std;
+using namespace RN;
+
+#define WHITE "\033[0m"
+#define RED "\033[1;31m"
+#define GREEN "\033[1;32m"
+#define BROWN "\033[1;33m"
+
+const size_t Log::_szRing;
+const size_t Log::_szData;
+const double Log::_toDrain = 0.01;
+
+Log::Record Log::_ring[Log::_szRing];
+atomic<size_t> Log::_head(0);
+size_t Log::_tail = 0;
+atomic<size_t> Log::_dropped(0);
+atomic<bool> Log::_running(false);
+thread Log::_thread;
+
+// Messages which are still in ring are printed at exit.
+static struct LogExit
+{
+	~LogExit()
+	{
+		Log::Stop();
+	}
+} _logExit;
+
+void Log::Start()
+{
+	if (_running.exchange(true))
+	{
+		return;
+	}
+
+	_thread = thread(_run);
+}
+
+void Log::Stop()
+{
+	if (_running.exchange(false))
+	{
+		_thread.join();
+	}
+
+	Drain();
+}
+
+size_t Log::Drain()
+{
+	char line[1024];
+	size_t count = 0;
+
+	for (;;)
+	{
+		Record &record = _ring[_tail & (_szRing - 1)];
+		size_t base = _tail & ~(_szRing - 1);
+		if (record.Seq.load(memory_order_acquire) != base + 1)
+		{
+			break;
+		}
+
+		size_t szLine = _format(record, line, sizeof(line));
+		fwrite(line, 1, szLine, stdout);
+
+		// slot is free for next lap of ring
+		record.Seq.store(base + _szRing, memory_order_release);
+		_tail++;
+		count++;
+	}
+
+	// messages dropped since last drain are reported once
+
+	static size_t reported = 0;
+	size_t dropped = _dropped.load(memory_order_relaxed);
+	if (dropped != reported)
+	{
+		printf(BROWN "[WARNING]" WHITE " LOG dropped(%zu)\n", dropped - reported);
+		reported = dropped;
+	}
+
+	if (count)
+	{
+		fflush(stdout);
+	}
+
+	return count;
+}
+
+size_t Log::GetDropped()
+{
+	return _dropped.load(memory_order_relaxed);
+}
+
+Log::Record *Log::_reserve(size_t *pPos)
+{
+	size_t pos = _head.load(memory_order_relaxed);
+	for (;;)
+	{
+		Record &record = _ring[pos & (_szRing - 1)];
+		size_t base = pos & ~(_szRing - 1);
+		ptrdiff_t diff = static_cast<ptrdiff_t>(record.Seq.load(memory_order_acquire) - base);
+
+		if (!diff)
+		{
+			// slot is free, take it unless other thread was faster (pos is reloaded on failure)
+			if (_head.compare_exchange_weak(pos, pos + 1, memory_order_relaxed))
+			{
+				*pPos = pos;
+				return &record;
+			}
+		}
+		else if (diff < 0)
+		{
+			// slot still holds record of previous lap, ring is full
+			return NULL;
+		}
+		else
+		{
+			// slot has been taken in this lap already
+			pos = _head.load(memory_order_relaxed);
+		}
+	}
+}
+
+void Log::_commit(Record *pRecord, size_t pos)
+{
+	pRecord->Seq.store((pos & ~(_szRing - 1)) + 1, memory_order_release);
+}
+
+void Log::_put(Record *pRecord, char type, const void *pValue, size_t sz)
+{
+	// type, size and value
+	if (pRecord->Size + 2 + sz > _szData)
+	{
+		return;
+	}
+
+	char *pDst = pRecord->Data + pRecord->Size;
+	pDst[0] = type;
+	pDst[1] = static_cast<char>(sz);
+	memcpy(pDst + 2, pValue, sz);
+	pRecord->Size += 2 + sz;
+}
+
+void Log::_pack(Record *)
+{
+}
+
+void Log::_pack(Record *pRecord, const char *pValue)
+{
+	size_t sz = strlen(pValue);
+	size_t szMax = _szData - pRecord->Size;
+	szMax = szMax > 2 ? szMax - 2 : 0;
+	szMax = szMax < 255 ? szMax : 255;
+
+	_put(pRecord, ARGSTR, pValue, sz < szMax ? sz : szMax);
+}
+
+void Log::_pack(Record *pRecord, char *pValue)
+{
+	_pack(pRecord, static_cast<const char*>(pValue));
+}
+
+size_t Log::_format(const Record &record, char *pLine, size_t szLine)
+{
+	const char *pTag =
+		record.Level == LOG_LEVEL_ERROR ? RED "[ERROR]" WHITE " " :
+		record.Level == LOG_LEVEL_WARNING ? BROWN "[WARNING]" WHITE " " :
+		GREEN "[OK]" WHITE " ";
+
+	// leave space for new line and terminating zero
+	size_t szMax = szLine - 2;
+	size_t sz = 0;
+	for (const char *p = pTag; *p && sz < szMax; p++)
+	{
+		pLine[sz++] = *p;
+	}
+
+	size_t offset = 0;
+	const char *pFmt = record.pFormat;
+	while (*pFmt && sz < szMax)
+	{
+		if (*pFmt != '%')
+		{
+			pLine[sz++] = *pFmt++;
+			continue;
+		}
+
+		if (pFmt[1] == '%')
+		{
+			pLine[sz++] = '%';
+			pFmt += 2;
+			continue;
+		}
+
+		// copy flags, width and precision, skip length modifiers
+
+		char spec[32];
+		size_t szSpec = 0;
+		spec[szSpec++] = *pFmt++;
+		while (*pFmt && strchr("-+ #0123456789.", *pFmt) && szSpec < sizeof(spec) - 4)
+		{
+			spec[szSpec++] = *pFmt++;
+		}
+		while (*pFmt && strchr("hlLqjzt", *pFmt))
+		{
+			pFmt++;
+		}
+
+		char conv = *pFmt;
+		if (!conv)
+		{
+			break;
+		}
+		pFmt++;
+
+		// unpack next argument, missing argument is printed as ?
+
+		if (offset + 2 > record.Size)
+		{
+			pLine[sz++] = '?';
+			continue;
+		}
+
+		char type = record.Data[offset];
+		size_t szValue = static_cast<unsigned char>(record.Data[offset + 1]);
+		const char *pValue = record.Data + offset + 2;
+		offset += 2 + szValue;
+
+		long long i = 0;
+		double d = 0.0;
+		if (type == ARGINT || type == ARGUINT)
+		{
+			memcpy(&i, pValue, sizeof(i));
+			d = type == ARGINT ? static_cast<double>(i) : static_cast<double>(static_cast<unsigned long long>(i));
+		}
+		else if (type == ARGDOUBLE)
+		{
+			memcpy(&d, pValue, sizeof(d));
+			i = static_cast<long long>(d);
+		}
+
+		// argument is converted to type of conversion
+
+		int szOut = 0;
+		if (strchr("di", conv))
+		{
+			memcpy(spec + szSpec, "lld", 4);
+			szOut = snprintf(pLine + sz, szMax - sz + 1, spec, i);
+		}
+		else if (strchr("uoxX", conv))
+		{
+			spec[szSpec] = 'l';
+			spec[szSpec + 1] = 'l';
+			spec[szSpec + 2] = conv;
+			spec[szSpec + 3] = 0;
+			szOut = snprintf(pLine + sz, szMax - sz + 1, spec, static_cast<unsigned long long>(i));
+		}
+		else if (conv == 'c')
+		{
+			memcpy(spec + szSpec, "c", 2);
+			szOut = snprintf(pLine + sz, szMax - sz + 1, spec, static_cast<int>(i));
+		}
+		else if (strchr("eEfFgGaA", conv))
+		{
+			spec[szSpec] = conv;
+			spec[szSpec + 1] = 0;
+			szOut = snprintf(pLine + sz, szMax - sz + 1, spec, d);
+		}
+		else if (conv == 's' && type == ARGSTR)
+		{
+			char str[256];
+			memcpy(str, pValue, szValue);
+			str[szValue] = 0;
+
+			memcpy(spec + szSpec, "s", 2);
+			szOut = snprintf(pLine + sz, szMax - sz + 1, spec, str);
+		}
+		else
+		{
+			pLine[sz++] = '?';
+		}
+
+		if (szOut > 0)
+		{
+			sz += static_cast<size_t>(szOut) < szMax - sz ? szOut : szMax - sz;
+		}
+	}
+
+	pLine[sz++] = '\n';
+	pLine[sz] = 0;
+
+	return sz;
+}
+
+void Log::_run()
+{
+	while (_running.load())
+	{
+		if (!Drain())
+		{
+			usleep(static_cast<useconds_t>(_toDrain * 1e6));
+		}
+	}
+}
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <atomic>
+#include <thread>
+#include <type_traits>
+
+// Log levels, messages above LOG_LEVEL are removed at compile time (make LOG_LEVEL=n).
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARNING 2
+#define LOG_LEVEL_OK 3
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_OK
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) RN::Log::Write(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) ((void)0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARNING
+#define LOG_WARNING(...) RN::Log::Write(LOG_LEVEL_WARNING, __VA_ARGS__)
+#else
+#define LOG_WARNING(...) ((void)0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_OK
+#define LOG_OK(...) RN::Log::Write(LOG_LEVEL_OK, __VA_ARGS__)
+#else
+#define LOG_OK(...) ((void)0)
+#endif
+
+// Message logged as OK on success, as error on failure.
+#define LOG_RESULT(ok, ...) do { if (ok) { LOG_OK(__VA_ARGS__); } else { LOG_ERROR(__VA_ARGS__); } } while (0)
+
+// Message logged as warning if failure is recovered, as error otherwise.
+#define LOG_RECOVERABLE(recovered, ...) do { if (recovered) { LOG_WARNING(__VA_ARGS__); } else { LOG_ERROR(__VA_ARGS__); } } while (0)
+
+namespace RN
+{
+	// Logger which keeps printf formatting off hot path. Write stores pointer to format string and binary
+	// copy of arguments into lock-free ring buffer (multiple producers, one consumer), records are formatted
+	// and printed to stdout by background thread (Start) or at Stop and at exit. Record is dropped if ring
+	// is full, so writer never blocks. Format must be string literal, supported conversions are d, i, u,
+	// o, x, X, c, e, f, g, a and s (length modifiers are ignored, strings are copied).
+	class Log
+	{
+		public:
+			// Store message into ring buffer.
+			// level: Level of message (LOG_LEVEL_ERROR, LOG_LEVEL_WARNING or LOG_LEVEL_OK).
+			// pFormat: printf format (string literal) without trailing new line.
+			// args: Arguments of format (arithmetic values or strings).
+			template<typename... Args>
+			static void Write(unsigned char level, const char *pFormat, const Args&... args);
+
+			// Start background thread which prints stored messages.
+			static void Start();
+
+			// Stop background thread and print remaining messages.
+			static void Stop();
+
+			// Print stored messages in calling thread (only if background thread is not running).
+			// Returns number of printed messages.
+			static size_t Drain();
+
+			// Number of messages dropped because ring buffer was full.
+			// Returns number of messages.
+			static size_t GetDropped();
+
+		private:
+			static const size_t _szRing = 1024;	// Number of records in ring buffer (power of 2).
+			static const size_t _szData = 224;	// Size of packed arguments of record [byte].
+			static const double _toDrain;		// Period of background thread when ring is empty [second].
+
+			// Type of packed argument.
+			enum ArgType : char { ARGINT = 'i', ARGUINT = 'u', ARGDOUBLE = 'd', ARGSTR = 's' };
+
+			// Record of one message. Seq minus lap base of slot is 0 if slot is free, 1 if record is ready
+			// (zero initialized ring is empty).
+			struct Record
+			{
+				std::atomic<size_t> Seq;
+				const char *pFormat;
+				unsigned char Level;
+				unsigned short Size;
+				char Data[_szData];
+			};
+
+			// Reserve free record.
+			// pPos: Position of reserved record.
+			// Returns record or NULL if ring is full.
+			static Record *_reserve(size_t *pPos);
+
+			// Publish reserved record to consumer.
+			// pRecord: Reserved record.
+			// pos: Position of reserved record.
+			static void _commit(Record *pRecord, size_t pos);
+
+			// Pack argument into record, argument is cut off if it does not fit.
+			static void _put(Record *pRecord, char type, const void *pValue, size_t sz);
+			static void _pack(Record *pRecord);
+			static void _pack(Record *pRecord, const char *pValue);
+			static void _pack(Record *pRecord, char *pValue);
+
+			template<typename T>
+			static void _pack(Record *pRecord, const T &value);
+
+			template<typename T, typename... Args>
+			static void _pack(Record *pRecord, const T &value, const Args&... args);
+
+			// Format record into line.
+			// record: Ready record.
+			// pLine: Line buffer.
+			// szLine: Size of line buffer [byte].
+			// Returns size of line without terminating zero [byte].
+			static size_t _format(const Record &record, char *pLine, size_t szLine);
+
+			// Loop of background thread.
+			static void _run();
+
+			static Record _ring[_szRing];		// Ring buffer.
+			static std::atomic<size_t> _head;	// Position of next record to reserve.
+			static size_t _tail;			// Position of next record to print (consumer only).
+			static std::atomic<size_t> _dropped;	// Number of dropped messages.
+			static std::atomic<bool> _running;	// Background thread is running.
+			static std::thread _thread;		// Background thread.
+	};
+
+	template<typename... Args>
+	void Log::Write(unsigned char level, const char *pFormat, const Args&... args)
+	{
+		size_t pos;
+		Record *pRecord = _reserve(&pos);
+		if (!pRecord)
+		{
+			_dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+
+		pRecord->pFormat = pFormat;
+		pRecord->Level = level;
+		pRecord->Size = 0;
+		_pack(pRecord, args...);
+
+		_commit(pRecord, pos);
+	}
+
+	template<typename T>
+	void Log::_pack(Record *pRecord, const T &value)
+	{
+		static_assert(std::is_arithmetic<T>::value, "Log argument must be arithmetic value or string");
+
+		if (std::is_floating_point<T>::value)
+		{
+			double v = static_cast<double>(value);
+			_put(pRecord, ARGDOUBLE, &v, sizeof(v));
+		}
+		else if (std::is_signed<T>::value)
+		{
+			long long v = static_cast<long long>(value);
+			_put(pRecord, ARGINT, &v, sizeof(v));
+		}
+		else
+		{
+			unsigned long long v = static_cast<unsigned long long>(value);
+			_put(pRecord, ARGUINT, &v, sizeof(v));
+		}
+	}
+
+	template<typename T, typename... Args>
+	void Log::_pack(Record *pRecord, const T &value, const Args&... args)
+	{
+		_pack(pRecord, value);
+		_pack(pRecord, args...);
+	}
+};
@@ -7,10 +7,10 @@
 #include<openssl/rsa.h>
 #include<openssl/pem.h>
 
-#define _DEBUG
-
 #include "comm.h"
 #include "clock.h"
+#include "trace.h"
+#include "log.h"
 
 #define WHITE "\033[0m"
 #define RED "\033[1;31m"
@@ -30,6 +30,18 @@ int main(int argc, char **argv, char **envp)
 	po::variables_map vm;
 	parse_args(argc, argv, desc, vm); 
 
+	// messages are printed by background thread so terminal output does not slow transfer
+
+	Log::Start();
+
+	// phases of transfer are recorded only if trace is requested
+
+	if (vm.count("trace") && !Trace::Enable(vm["traceevents"].as<unsigned int>()))
+	{
+		cout << RED "[ERROR]" WHITE " Unable to enable trace\n";
+		return -1;
+	}
+
 	if (vm.count("genkey"))
 	{
 		bool ok = generate_key(
@@ -46,7 +58,19 @@ int main(int argc, char **argv, char **envp)
 	if (vm.count("transmit"))
  	{
 		Comm c;
- 		c.Init();
+ 		c.Init(vm["device"].as<string>().data(), vm.count("warm"));
+
+		if (vm.count("metrics") && !c.SetMetrics(vm["metrics"].as<string>().data()))
+		{
+			cout << RED "[ERROR]" WHITE " Unable to create metrics segment\n";
+			return -1;
+		}
+
+		if (vm.count("capture") && !c.SetCapture(vm["capture"].as<string>().data()))
+		{
+			cout << RED "[ERROR]" WHITE " Unable to create capture file\n";
+			return -1;
+		}
  
  		PacketInfo info;
  		info.LocalId = static_cast<unsigned char>(vm["localid"].as<int>());
@@ -55,8 +79,42 @@ int main(int argc, char **argv, char **envp)
 
  		c.SetInfo(&info);
 
+		c.SetCompress(vm.count("compress"));
+
+		bool okFEC = c.SetFEC(static_cast<unsigned char>(vm["fec"].as<int>()));
+		if (!okFEC)
+		{
+			cout << RED "[ERROR]" WHITE " Invalid number of parity bytes\n";
+			return -1;
+		}
+
+		bool okRetry = c.SetRetry(static_cast<unsigned char>(vm["retry"].as<int>()));
+		if (!okRetry)
+		{
+			cout << RED "[ERROR]" WHITE " Invalid number of retries\n";
+			return -1;
+		}
+
+		if (vm.count("bitrate"))
+		{
+			bool okRate = c.SetBitRate(vm["bitrate"].as<unsigned int>());
+			if (!okRate)
+			{
+				cout << RED "[ERROR]" WHITE " Invalid bit rate\n";
+				return -1;
+			}
+		}
+
+		bool okWindow = c.SetWindow(static_cast<unsigned char>(vm["window"].as<int>()));
+		if (!okWindow)
+		{
+			cout << RED "[ERROR]" WHITE " Invalid window size\n";
+			return -1;
+		}
+
 		bool encryptPub = false;
 		bool encryptPvt = false;
+		bool encryptSym = false;
 
 		if (vm.count("publickey") && vm.count("privatekey"))
 		{
@@ -66,6 +124,14 @@ int main(int argc, char **argv, char **envp)
 
 			encryptPub = vm.count("encryptpub");
 			encryptPvt = vm.count("encryptpvt");
+			encryptSym = vm.count("encryptsym");
+		}
+
+		bool stream = vm.count("stream");
+		if (stream && (encryptPub || encryptPvt || encryptSym || vm.count("compress")))
+		{
+			cout << RED "[ERROR]" WHITE " Stream cannot be encrypted or compressed\n";
+			return -1;
 		}
 
 		ifstream ifs;
@@ -84,7 +150,7 @@ int main(int argc, char **argv, char **envp)
 		
 		istream &is = vm.count("input") ? ifs : cin;
 
-		size_t szBuf = encryptPub || encryptPvt ? c.GetSzDecryptBuf() : c.GetMaxSz();
+		size_t szBuf = encryptSym ? c.GetSzSymBuf() : encryptPub || encryptPvt ? c.GetSzDecryptBuf() : c.GetMaxSz();
 		size_t szData = szBuf - 1;
 		char *pBuf = new char[szBuf];
 		char *pData = pBuf + 1;
@@ -93,20 +159,28 @@ int main(int argc, char **argv, char **envp)
 
 		size_t sent = 0;
 
-#ifdef _DEBUG
 		if (total)
 		{
- 			printf(GREEN "[OK]" WHITE " DATA SEND START size(%u)\n", total);
+ 			LOG_OK("DATA SEND START size(%u)", total);
 		}
 		else
 		{
- 			cout << GREEN "[OK]" WHITE " DATA SEND START\n";
+ 			LOG_OK("DATA SEND START");
 		}
 
+#if LOG_LEVEL >= LOG_LEVEL_OK
 		Clock _clk;
 #endif
 
-		bool okSend;
+		bool okSend = true;
+		if (stream)
+		{
+			// whole input is sent in one session
+
+			okSend = c.SendStream(is, true, &sent);
+			*pBuf = false;
+		}
+
 		while (*pBuf)
 		{
 			is.read(pData, szData);
@@ -121,6 +195,10 @@ int main(int argc, char **argv, char **envp)
 			{
 				okSend = c.EncryptPvtSend(pBuf, read + 1, true);
 			}
+			else if (encryptSym)
+			{
+				okSend = c.EncryptSymSend(pBuf, read + 1, true);
+			}
 			else
 			{
 				okSend = c.Send(pBuf, read + 1, true);
@@ -128,62 +206,70 @@ int main(int argc, char **argv, char **envp)
 
 			if (!okSend)
 			{
-#ifdef _DEBUG
 				if (total)
 				{
-					printf(RED "[ERROR]" WHITE " DATA SEND size(%u/%u)\n", read, total);
+					LOG_ERROR("DATA SEND size(%u/%u)", read, total);
 				}
 				else
 				{
-					printf(RED "[ERROR]" WHITE " DATA SEND size(%u)\n", read);
+					LOG_ERROR("DATA SEND size(%u)", read);
 				}
-#endif
 				break;
 			}
 
-#ifdef _DEBUG
 			if (total)
 			{
- 				printf(GREEN "[OK]" WHITE " DATA SEND size(%u/%u)\n", read, total);
+ 				LOG_OK("DATA SEND size(%u/%u)", read, total);
 			}
 			else
 			{
- 				printf(GREEN "[OK]" WHITE " DATA SEND size(%u)\n", read);
+ 				LOG_OK("DATA SEND size(%u)", read);
 			}
-#endif
 
 			sent += read;
 		}
 
-#ifdef _DEBUG
-		if (okSend)
-		{
-			cout << GREEN "[OK]" WHITE;
-		}
-		else
-		{
-			cout << RED "[ERROR]" WHITE;
-		}
-
 		if (total)
 		{
-			printf(" DATA SEND END size(%u/%u)\n", sent, total);
+			LOG_RESULT(okSend, "DATA SEND END size(%u/%u)", sent, total);
 		}
 		else
 		{
-			printf(" DATA SEND END size(%u)\n", sent);
+			LOG_RESULT(okSend, "DATA SEND END size(%u)", sent);
 		}
 
+#if LOG_LEVEL >= LOG_LEVEL_OK
+		// ceiling of message of full buffer (or whole input in stream) given by air time of frames only
+
 		double time = _clk.Now();
-		printf("Data sent in %f [second] with mean bandwidth %u\n", time, static_cast<unsigned int>(static_cast<double>(sent) / time));
+		double bandwidth = static_cast<double>(sent) / time;
+		double ceiling = c.GetGoodputMax(stream ? sent : sent < szData ? sent + 1 : szBuf, true, stream);
+		LOG_OK("Data sent in %f [second] with mean bandwidth %u (%.1f%% of %u)", time, static_cast<unsigned int>(bandwidth),
+			ceiling > 0.0 ? 100.0 * bandwidth / ceiling : 0.0, static_cast<unsigned int>(ceiling));
 #endif
 
+		// tail latencies are hidden by mean bandwidth
+
+		c.PrintLatency();
+
 		delete[] pBuf;
  	}
 	else if (vm.count("receive"))
  	{
 		Comm c;
- 		c.Init();
+ 		c.Init(vm["device"].as<string>().data(), vm.count("warm"));
+
+		if (vm.count("metrics") && !c.SetMetrics(vm["metrics"].as<string>().data()))
+		{
+			cout << RED "[ERROR]" WHITE " Unable to create metrics segment\n";
+			return -1;
+		}
+
+		if (vm.count("capture") && !c.SetCapture(vm["capture"].as<string>().data()))
+		{
+			cout << RED "[ERROR]" WHITE " Unable to create capture file\n";
+			return -1;
+		}
  
  		PacketInfo info;
  		info.LocalId = static_cast<unsigned char>(vm["localid"].as<int>());
@@ -192,8 +278,33 @@ int main(int argc, char **argv, char **envp)
 
  		c.SetInfo(&info);
 
+		bool okFEC = c.SetFEC(static_cast<unsigned char>(vm["fec"].as<int>()));
+		if (!okFEC)
+		{
+			cout << RED "[ERROR]" WHITE " Invalid number of parity bytes\n";
+			return -1;
+		}
+
+		bool okRetry = c.SetRetry(static_cast<unsigned char>(vm["retry"].as<int>()));
+		if (!okRetry)
+		{
+			cout << RED "[ERROR]" WHITE " Invalid number of retries\n";
+			return -1;
+		}
+
+		if (vm.count("bitrate"))
+		{
+			bool okRate = c.SetBitRate(vm["bitrate"].as<unsigned int>());
+			if (!okRate)
+			{
+				cout << RED "[ERROR]" WHITE " Invalid bit rate\n";
+				return -1;
+			}
+		}
+
 		bool decryptPub = false;
 		bool decryptPvt = false;
+		bool decryptSym = false;
 
 		if (vm.count("publickey") && vm.count("privatekey"))
 		{
@@ -203,9 +314,12 @@ int main(int argc, char **argv, char **envp)
 
 			decryptPub = vm.count("decryptpub");
 			decryptPvt = vm.count("decryptpvt");
+			decryptSym = vm.count("decryptsym");
 		}
 
-		size_t szBuf = decryptPub || decryptPvt ? c.GetSzDecryptBuf() : c.GetMaxSz();
+		bool stream = vm.count("stream");
+
+		size_t szBuf = decryptSym ? c.GetSzSymBuf() : decryptPub || decryptPvt ? c.GetSzDecryptBuf() : c.GetMaxSz();
 		size_t szData = szBuf - 1;
 		char *pBuf = new char[szBuf];
 		char *pData = pBuf + 1;
@@ -219,63 +333,75 @@ int main(int argc, char **argv, char **envp)
 		
 		ostream &os = vm.count("output") ? ofs : cout;
 
-#ifdef _DEBUG
- 		cout << GREEN "[OK]" WHITE " DATA RECEIVE START\n";
+		LOG_OK("DATA RECEIVE START");
 
+#if LOG_LEVEL >= LOG_LEVEL_OK
 		Clock _clk;
 #endif
 
 		size_t received = 0;
 		bool okRX;
 
-		do
+		if (stream)
 		{
-			size_t szRX;
+			// whole stream is received in one session
 
-			if (decryptPub)
-			{
-				okRX = c.ReceiveDecryptPub(pBuf, szBuf, &szRX);
-			}
-			else if (decryptPvt)
-			{
-				okRX = c.ReceiveDecryptPvt(pBuf, szBuf, &szRX);
-			}
-			else
+			okRX = c.ReceiveStream(os, &received);
+		}
+		else
+		{
+			do
 			{
-				okRX = c.Receive(pBuf, szBuf, &szRX);
-			}
+				size_t szRX;
 
-			if (!okRX || szRX < 2)
-			{
-#ifdef _DEBUG
-					printf(RED "[ERROR]" WHITE " DATA RECEIVE size(%u)\n", szRX ? szRX - 1 : 0);
-#endif
-				break;
-			}
+				if (decryptPub)
+				{
+					okRX = c.ReceiveDecryptPub(pBuf, szBuf, &szRX);
+				}
+				else if (decryptPvt)
+				{
+					okRX = c.ReceiveDecryptPvt(pBuf, szBuf, &szRX);
+				}
+				else if (decryptSym)
+				{
+					okRX = c.ReceiveDecryptSym(pBuf, szBuf, &szRX);
+				}
+				else
+				{
+					okRX = c.Receive(pBuf, szBuf, &szRX);
+				}
+
+				if (!okRX || szRX < 2)
+				{
+					LOG_ERROR("DATA RECEIVE size(%u)", szRX ? szRX - 1 : 0);
+					break;
+				}
+
+	 			LOG_OK("DATA RECEIVE size(%u)", szRX - 1);
 
-#ifdef _DEBUG
- 			printf(GREEN "[OK]" WHITE " DATA RECEIVE size(%u)\n", szRX - 1);
+				os.write(pData, (szRX < szBuf ? szRX : szBuf) - 1);
+				os.flush();
+				received += szRX - 1;
+			} while(*pBuf);
+		}
+
+		LOG_RESULT(okRX, "DATA RECEIVE END size(%u)", received);
+
+#if LOG_LEVEL >= LOG_LEVEL_OK
+		double time = _clk.Now();
+		LOG_OK("Data sent in %f [second] with mean bandwidth %u", time, static_cast<unsigned int>(static_cast<double>(received) / time));
 #endif
 
-			os.write(pData, (szRX < szBuf ? szRX : szBuf) - 1);
-			os.flush();
-			received += szRX - 1;
-		} while(*pBuf);
+		// acknowledge last packet again if its ack is lost, so sending node finishes too
 
-#ifdef _DEBUG
 		if (okRX)
 		{
-			cout << GREEN "[OK]" WHITE;
-		}
-		else
-		{
-			cout << RED "[ERROR]" WHITE;
+			c.Linger();
 		}
-		printf(" DATA RECEIVE END size(%u)\n", received);
 
-		double time = _clk.Now();
-		printf("Data sent in %f [second] with mean bandwidth %u\n", time, static_cast<unsigned int>(static_cast<double>(received) / time));
-#endif
+		// tail latencies are hidden by mean bandwidth
+
+		c.PrintLatency();
 
 		delete[] pBuf;
  	}
@@ -286,6 +412,14 @@ int main(int argc, char **argv, char **envp)
 		cout << desc << "\n";
 	}
 
+	Log::Stop();
+
+	if (vm.count("trace") && !Trace::Dump(vm["trace"].as<string>().data()))
+	{
+		cout << RED "[ERROR]" WHITE " Unable to write trace\n";
+		return -1;
+	}
+
 	return 0;
 };
 
@@ -355,6 +489,8 @@ void parse_args(int argc, char **argv, po::options_description &optDesc, po::var
 		("help,h", "Help screen")
 		("transmit,t", "Transmit data from TX buffer")
 		("receive,r", "Receive data into RX buffer")
+		("device,d", po::value<string>()->default_value("/dev/ttyAMA0"), "Serial device connected to RN2483 (or pseudo-terminal of emulator)")
+		("warm", "Skip reset of RN2483 if it is already configured by previous run")
 		("publickey,k", po::value<string>(), "Public key to use with RSA encryption")
 		("privatekey,i", po::value<string>(), "Private key to use with RSA encryption")
 		("genkey,g", "Generate public and private RSA key")
@@ -364,10 +500,22 @@ void parse_args(int argc, char **argv, po::options_description &optDesc, po::var
 		("localid", po::value<int>()->default_value(20), "Local id number")
 		("remoteid", po::value<int>()->default_value(21), "Id number of remote node")
 		("port", po::value<int>()->default_value(15), "Port number used in communication")
+		("stream,s", "Send or receive whole input as one stream instead of separate messages (no encryption and compression)")
+		("compress,z", "Compress data before sending (and before encryption)")
+		("fec", po::value<int>()->default_value(0), "Number of Reed-Solomon parity bytes in each packet (0 to disable, same on both nodes)")
+		("window,w", po::value<int>()->default_value(8), "Number of packets sent before waiting for acknowledge (1 for stop-and-wait)")
+		("retry", po::value<int>()->default_value(4), "Number of retries of packet with doubled timeout (same on both nodes)")
+		("bitrate", po::value<unsigned int>(), "Bit rate of radio [bit/second] (same on both nodes, 2500 if not set)")
+		("metrics", po::value<string>(), "Publish counters in shared memory segment with this name (e.g. /rn2483) for monitor")
+		("capture", po::value<string>(), "Record frames into pcap-ng file (for Wireshark or replay)")
+		("trace", po::value<string>(), "Record phases of transfer and write them as Chrome trace JSON into this file")
+		("traceevents", po::value<unsigned int>()->default_value(65536), "Number of recorded phases kept for trace (oldest are dropped)")
 		("encryptpub", "Encrypt data with public key")
 		("encryptpvt", "Encrypt data with private key")
 		("decryptpub", "Decrypt data with public key")
-		("decryptpvt", "Decrypt data with private key");
+		("decryptpvt", "Decrypt data with private key")
+		("encryptsym", "Encrypt data with session key which is encrypted with public key")
+		("decryptsym", "Decrypt data with session key which is decrypted with private key");
 
 	po::store(po::parse_command_line(argc, argv, optDesc), varMap);
 	po::notify(varMap);
@@ -0,0 +1,187 @@
+#include "metrics.h"
+#include <cstring>
+#include <cstdio>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+
+#include "clock.h"
+
+using namespace std;
+using namespace RN;
+
+const uint32_t Metrics::_magic = 0x524e4d31;
+const double Metrics::_dutyCycle = 0.001;	// 863 - 865 MHz (ETSI EN 300 220 band g)
+
+const char *Metrics::_names[METCOUNT] =
+{
+	"frames_tx",
+	"frames_rx",
+	"retransmit",
+	"timeout",
+	"err_fec",
+	"err_size",
+	"bytes_air",
+	"airtime_ms",
+	"airtime_hour_ms",
+	"duty_budget_ms",
+	"srtt_us",
+	"rto_us"
+};
+
+Metrics::Metrics() :
+	_pSeg(&_local),
+	_mapped(false),
+	_airTotal(0.0),
+	_airHour(0.0),
+	_hourStart(Clock::Total())
+{
+	_local.Magic = _magic;
+	_local.Count = METCOUNT;
+	_local.Pid = getpid();
+	for (unsigned int i = 0; i < METCOUNT; i++)
+	{
+		_local.Values[i].store(0);
+	}
+	_local.Values[METDUTYBUDGET].store(static_cast<uint32_t>(_dutyCycle * 3600.0 * 1000.0));
+
+	_name[0] = 0;
+}
+
+Metrics::~Metrics()
+{
+	_close();
+}
+
+bool Metrics::Create(const char *pName)
+{
+	if (strlen(pName) >= sizeof(_name))
+	{
+		return false;
+	}
+
+	_close();
+
+	int fd = shm_open(pName, O_CREAT | O_RDWR, 0644);
+	if (fd < 0)
+	{
+		return false;
+	}
+
+	bool okSize = ftruncate(fd, sizeof(Segment)) == 0;
+	void *ptr = okSize ? mmap(NULL, sizeof(Segment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+	close(fd);
+
+	if (ptr == MAP_FAILED)
+	{
+		shm_unlink(pName);
+		return false;
+	}
+
+	// current values are copied, magic is written last so reader sees initialized segment
+
+	Segment *pSeg = static_cast<Segment*>(ptr);
+	pSeg->Magic = 0;
+	pSeg->Count = METCOUNT;
+	pSeg->Pid = getpid();
+	for (unsigned int i = 0; i < METCOUNT; i++)
+	{
+		pSeg->Values[i].store(_local.Values[i].load());
+	}
+	atomic_thread_fence(memory_order_release);
+	pSeg->Magic = _magic;
+
+	strcpy(_name, pName);
+	_pSeg = pSeg;
+	_mapped = true;
+
+	return true;
+}
+
+bool Metrics::Open(const char *pName)
+{
+	_close();
+
+	int fd = shm_open(pName, O_RDONLY, 0);
+	if (fd < 0)
+	{
+		return false;
+	}
+
+	void *ptr = mmap(NULL, sizeof(Segment), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (ptr == MAP_FAILED)
+	{
+		return false;
+	}
+
+	Segment *pSeg = static_cast<Segment*>(ptr);
+	if (pSeg->Magic != _magic || pSeg->Count != METCOUNT)
+	{
+		munmap(ptr, sizeof(Segment));
+		return false;
+	}
+
+	_pSeg = pSeg;
+	_mapped = true;
+
+	return true;
+}
+
+void Metrics::AddAir(size_t sz, double time)
+{
+	// duty cycle limit applies to each hour
+
+	double now = Clock::Total();
+	if (now - _hourStart >= 3600.0 * 1e6)
+	{
+		_hourStart = now;
+		_airHour = 0.0;
+	}
+
+	_airTotal += time;
+	_airHour += time;
+
+	double budget = _dutyCycle * 3600.0 - _airHour;
+
+	Add(METBYTESAIR, sz);
+	Set(METAIRTIME, static_cast<uint32_t>(_airTotal * 1000.0));
+	Set(METAIRHOUR, static_cast<uint32_t>(_airHour * 1000.0));
+	Set(METDUTYBUDGET, budget > 0.0 ? static_cast<uint32_t>(budget * 1000.0) : 0);
+}
+
+uint32_t Metrics::GetPid()
+{
+	return _pSeg->Pid;
+}
+
+const char *Metrics::GetName(Metric metric)
+{
+	return metric < METCOUNT ? _names[metric] : "";
+}
+
+void Metrics::_close()
+{
+	if (!_mapped)
+	{
+		return;
+	}
+
+	// values of writer stay available in private memory
+
+	if (_name[0])
+	{
+		for (unsigned int i = 0; i < METCOUNT; i++)
+		{
+			_local.Values[i].store(_pSeg->Values[i].load());
+		}
+
+		shm_unlink(_name);
+		_name[0] = 0;
+	}
+
+	munmap(_pSeg, sizeof(Segment));
+	_pSeg = &_local;
+	_mapped = false;
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+
+namespace RN
+{
+	// Published counters and gauges.
+	enum Metric
+	{
+		METFRAMESTX,	// Frames sent (data and acks).
+		METFRAMESRX,	// Frames received.
+		METRETRANSMIT,	// Data packets sent again.
+		METTIMEOUT,	// Ack and receive timeouts.
+		METERRFEC,	// Frames which FEC could not correct.
+		METERRSIZE,	// Packets with size different from their info.
+		METBYTESAIR,	// Bytes of sent frames [byte].
+		METAIRTIME,	// Air time of sent frames [millisecond].
+		METAIRHOUR,	// Air time of sent frames in current hour [millisecond].
+		METDUTYBUDGET,	// Air time left in current hour by duty cycle limit [millisecond].
+		METSRTT,	// Smoothed round-trip time [microsecond].
+		METRTO,		// Retransmission timeout [microsecond].
+		METCOUNT
+	};
+
+	// Metrics of Comm published in POSIX shared memory segment, so monitoring process can read them
+	// without parsing logs. Values are 32 bit lock-free atomics (also on 32 bit ARM), writer updates them
+	// with relaxed stores and never waits for readers. Without segment values are kept in private memory.
+	class Metrics
+	{
+		public:
+			// Layout of segment.
+			struct Segment
+			{
+				uint32_t Magic;				// _magic when segment is initialized.
+				uint32_t Count;				// Number of values (METCOUNT of writer).
+				uint32_t Pid;				// Process id of writer.
+				std::atomic<uint32_t> Values[METCOUNT];	// Values indexed by Metric.
+			};
+
+			// Default class constructor.
+			Metrics();
+
+			// Default class destructor, removes segment.
+			~Metrics();
+
+			// Create shared memory segment and publish values into it (current values are kept).
+			// pName: Name of segment (e.g. /rn2483).
+			// Returns true on success, false on failure.
+			bool Create(const char *pName);
+
+			// Map existing segment for reading.
+			// pName: Name of segment.
+			// Returns true on success, false on failure.
+			bool Open(const char *pName);
+
+			// Add to counter.
+			// metric: Counter.
+			// n: Increment.
+			void Add(Metric metric, uint32_t n = 1);
+
+			// Set gauge.
+			// metric: Gauge.
+			// value: Value.
+			void Set(Metric metric, uint32_t value);
+
+			// Get value.
+			// metric: Counter or gauge.
+			// Returns value.
+			uint32_t Get(Metric metric);
+
+			// Add sent frame to air time counters and duty cycle budget.
+			// sz: Size of frame [byte].
+			// time: Air time of frame [second].
+			void AddAir(size_t sz, double time);
+
+			// Process id of writer.
+			// Returns process id.
+			uint32_t GetPid();
+
+			// Name of metric.
+			// metric: Counter or gauge.
+			// Returns name.
+			static const char *GetName(Metric metric);
+
+		private:
+			// Unmap segment and use private memory again.
+			void _close();
+
+			static_assert(ATOMIC_INT_LOCK_FREE == 2, "Shared metrics need lock-free 32 bit atomics");
+
+			static const uint32_t _magic;		// Marks initialized segment.
+			static const double _dutyCycle;		// Duty cycle limit of band [fraction of hour].
+			static const char *_names[METCOUNT];	// Names of metrics.
+
+			Segment _local;			// Values if no segment is mapped.
+			Segment *_pSeg;			// Current values.
+			char _name[64];			// Name of created segment (empty if not created).
+			bool _mapped;			// Segment is mapped.
+			double _airTotal;		// Air time of sent frames [second].
+			double _airHour;		// Air time of sent frames in current hour [second].
+			double _hourStart;		// Start of current hour [microsecond since epoch].
+	};
+
+	// counters are updated on hot path, so they are inlined
+
+	inline void Metrics::Add(Metric metric, uint32_t n)
+	{
+		_pSeg->Values[metric].fetch_add(n, std::memory_order_relaxed);
+	}
+
+	inline void Metrics::Set(Metric metric, uint32_t value)
+	{
+		_pSeg->Values[metric].store(value, std::memory_order_relaxed);
+	}
+
+	inline uint32_t Metrics::Get(Metric metric)
+	{
+		return _pSeg->Values[metric].load(std::memory_order_relaxed);
+	}
+};
@@ -0,0 +1,72 @@
+#include <boost/program_options.hpp>
+#include <iostream>
+#include <string>
+#include <cstdio>
+#include <signal.h>
+#include <unistd.h>
+
+#include "metrics.h"
+
+#define WHITE "\033[0m"
+#define RED "\033[1;31m"
+
+using namespace std;
+using namespace RN;
+namespace po = boost::program_options;
+
+void parse_args(int argc, char **argv, po::options_description &optDesc, po::variables_map &varMap);
+
+int main(int argc, char **argv)
+{
+	po::options_description desc;
+	po::variables_map vm;
+	parse_args(argc, argv, desc, vm);
+
+	if (vm.count("help"))
+	{
+		cout << desc << "\n";
+		return 0;
+	}
+
+	Metrics metrics;
+	if (!metrics.Open(vm["metrics"].as<string>().data()))
+	{
+		cout << RED "[ERROR]" WHITE " Unable to open metrics segment\n";
+		return -1;
+	}
+
+	// values are read without locking, writer is never slowed down
+
+	double interval = vm["interval"].as<double>();
+	do
+	{
+		uint32_t pid = metrics.GetPid();
+		printf("pid %u %s\n", pid, kill(pid, 0) == 0 ? "running" : "stopped");
+
+		for (unsigned int i = 0; i < METCOUNT; i++)
+		{
+			Metric metric = static_cast<Metric>(i);
+			printf("%s %u\n", Metrics::GetName(metric), metrics.Get(metric));
+		}
+
+		if (interval > 0.0)
+		{
+			printf("\n");
+			fflush(stdout);
+			usleep(static_cast<useconds_t>(interval * 1e6));
+		}
+	} while (interval > 0.0);
+
+	return 0;
+}
+
+void parse_args(int argc, char **argv, po::options_description &optDesc, po::variables_map &varMap)
+{
+	optDesc.add_options()
+		("help,h", "Help screen")
+		("metrics,m", po::value<string>()->default_value("/rn2483"), "Name of shared memory segment published by app --metrics")
+		("interval,n", po::value<double>()->default_value(0.0), "Print values again after this time [second] (0 prints once)");
+
+	po::store(po::parse_command_line(argc, argv, optDesc), varMap);
+	po::notify(varMap);
+};
@@ -0,0 +1,179 @@
+#include "packet.h"
+
+using namespace RN;
+
+// Store first bytes of packet info which are common to part and init packets.
+static void _encodePart(const PacketInfoPart *pInfo, unsigned char type, unsigned char *ptr)
+{
+	ptr[0] = type | (pInfo->Poll ? PFPOLL : 0) | (pInfo->End ? PFEND : 0);
+	ptr[1] = pInfo->Session;
+	ptr[2] = pInfo->SegId;
+	ptr[3] = pInfo->Size;
+}
+
+// Load first bytes of packet info which are common to part and init packets.
+static void _decodePart(const unsigned char *ptr, PacketInfoPart *pInfo)
+{
+	pInfo->Poll = ptr[0] & PFPOLL;
+	pInfo->End = ptr[0] & PFEND;
+	pInfo->Session = ptr[1];
+	pInfo->SegId = ptr[2];
+	pInfo->Size = ptr[3];
+}
+
+size_t RN::GetSzInfoInit(const PacketInfoInit *pInfo)
+{
+	size_t sz = SZ_INFO_INIT + 1;
+	for (size_t total = pInfo->SizeTotal >> 7; total; total >>= 7)
+	{
+		sz++;
+	}
+
+	return sz;
+}
+
+size_t RN::EncodeInit(const PacketInfoInit *pInfo, char *pBuf)
+{
+	unsigned char *ptr = reinterpret_cast<unsigned char*>(pBuf);
+
+	_encodePart(pInfo, PTINIT, ptr);
+	ptr[0] |= (pInfo->Ack ? PFACK : 0) | (pInfo->Compress ? PFCOMP : 0) | (pInfo->Stream ? PFSTREAM : 0);
+	ptr[4] = pInfo->LocalId;
+	ptr[5] = pInfo->RemoteId;
+	ptr[6] = pInfo->Port;
+	ptr[7] = pInfo->Window;
+
+	// total size as unsigned LEB128 varint
+
+	size_t sz = SZ_INFO_INIT;
+	size_t total = pInfo->SizeTotal;
+	do
+	{
+		ptr[sz] = total & 0x7F;
+		total >>= 7;
+		ptr[sz++] |= total ? 0x80 : 0;
+	} while (total);
+
+	return sz;
+}
+
+size_t RN::EncodePart(const PacketInfoPart *pInfo, char *pBuf)
+{
+	_encodePart(pInfo, PTPART, reinterpret_cast<unsigned char*>(pBuf));
+
+	return SZ_INFO_PART;
+}
+
+size_t RN::EncodeRsp(const PacketInfoRsp *pInfo, char *pBuf)
+{
+	unsigned char *ptr = reinterpret_cast<unsigned char*>(pBuf);
+
+	ptr[0] = PTRSP | (pInfo->RequestResend ? PFRESEND : 0);
+	ptr[1] = pInfo->Session;
+	ptr[2] = pInfo->SegId;
+
+	return SZ_INFO_RSP;
+}
+
+size_t RN::EncodeRspWin(const PacketInfoRspWin *pInfo, char *pBuf)
+{
+	unsigned char *ptr = reinterpret_cast<unsigned char*>(pBuf);
+
+	ptr[0] = PTRSPWIN;
+	ptr[1] = pInfo->Session;
+	ptr[2] = pInfo->SegId;
+	ptr[3] = pInfo->Mask;
+	ptr[4] = pInfo->Mask >> 8;
+	ptr[5] = pInfo->Mask >> 16;
+	ptr[6] = pInfo->Mask >> 24;
+
+	return SZ_INFO_RSPWIN;
+}
+
+size_t RN::DecodeInit(const char *pBuf, size_t sz, PacketInfoInit *pInfo)
+{
+	const unsigned char *ptr = reinterpret_cast<const unsigned char*>(pBuf);
+
+	if (sz <= SZ_INFO_INIT || (ptr[0] & PFTYPE) != PTINIT || ptr[2])
+	{
+		return 0;
+	}
+
+	_decodePart(ptr, pInfo);
+	pInfo->Ack = ptr[0] & PFACK;
+	pInfo->Compress = ptr[0] & PFCOMP;
+	pInfo->Stream = ptr[0] & PFSTREAM;
+	pInfo->LocalId = ptr[4];
+	pInfo->RemoteId = ptr[5];
+	pInfo->Port = ptr[6];
+	pInfo->Window = ptr[7];
+
+	// total size as unsigned LEB128 varint
+
+	size_t idx = SZ_INFO_INIT;
+	size_t total = 0;
+	unsigned int shift = 0;
+	do
+	{
+		if (idx >= sz || idx >= SZ_INFO_INIT_MAX)
+		{
+			return 0;
+		}
+
+		total |= static_cast<size_t>(ptr[idx] & 0x7F) << shift;
+		shift += 7;
+	} while (ptr[idx++] & 0x80);
+
+	pInfo->SizeTotal = total;
+
+	return idx;
+}
+
+size_t RN::DecodePart(const char *pBuf, size_t sz, PacketInfoPart *pInfo)
+{
+	const unsigned char *ptr = reinterpret_cast<const unsigned char*>(pBuf);
+
+	if (sz < SZ_INFO_PART || (ptr[0] & PFTYPE) != PTPART || !ptr[2])
+	{
+		return 0;
+	}
+
+	_decodePart(ptr, pInfo);
+
+	return SZ_INFO_PART;
+}
+
+size_t RN::DecodeRsp(const char *pBuf, size_t sz, PacketInfoRsp *pInfo)
+{
+	const unsigned char *ptr = reinterpret_cast<const unsigned char*>(pBuf);
+
+	if (sz != SZ_INFO_RSP || (ptr[0] & PFTYPE) != PTRSP)
+	{
+		return 0;
+	}
+
+	pInfo->RequestResend = ptr[0] & PFRESEND;
+	pInfo->Session = ptr[1];
+	pInfo->SegId = ptr[2];
+
+	return SZ_INFO_RSP;
+}
+
+size_t RN::DecodeRspWin(const char *pBuf, size_t sz, PacketInfoRspWin *pInfo)
+{
+	const unsigned char *ptr = reinterpret_cast<const unsigned char*>(pBuf);
+
+	if (sz != SZ_INFO_RSPWIN || (ptr[0] & PFTYPE) != PTRSPWIN)
+	{
+		return 0;
+	}
+
+	pInfo->Session = ptr[1];
+	pInfo->SegId = ptr[2];
+	pInfo->Mask =	static_cast<unsigned int>(ptr[3]) |
+			static_cast<unsigned int>(ptr[4]) << 8 |
+			static_cast<unsigned int>(ptr[5]) << 16 |
+			static_cast<unsigned int>(ptr[6]) << 24;
+
+	return SZ_INFO_RSPWIN;
+}
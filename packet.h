@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cstddef>
+
+namespace RN
+{
+	// Information for TX packet.
+	struct PacketInfo
+	{
+		unsigned char LocalId;		// Id of local (this) node.
+		unsigned char RemoteId;		// Id of remote node to which data will be send.
+		unsigned char Port;		// Port of packet.
+	};
+
+	struct PacketInfoPart : public PacketInfo
+	{
+		unsigned char Session;		// Session id of message (replaces LocalId, RemoteId and Port in part packets).
+		unsigned char Size;		// Packet data size.
+		unsigned char SegId;		// Packet segment id.
+		bool Poll;			// Sender waits for acknowledge of window after this packet.
+		bool End;			// Last packet of message or stream.
+	};
+
+	struct PacketInfoInit : public PacketInfoPart
+	{
+		bool Ack;			// Should receiving node acknowledge.
+		bool Compress;			// Data of message are compressed.
+		bool Stream;			// Part packets carry stream of unknown size (SizeTotal is 0).
+		unsigned char Window;		// Number of part packets sent before waiting for acknowledge (1 for stop-and-wait).
+		size_t SizeTotal;		// Total size of data (in all packets) [byte].
+	};
+
+	// Acknowledge information on TX from receiving node.
+	struct PacketInfoRsp : public PacketInfo
+	{
+		unsigned char Session;		// Session id of acknowledged message.
+		bool RequestResend;		// Packet is not received and request to resend it.
+		unsigned char SegId;		// Packet segment id.
+	};
+
+	// Acknowledge information on window of part packets from receiving node.
+	struct PacketInfoRspWin : public PacketInfo
+	{
+		unsigned char Session;		// Session id of acknowledged message.
+		unsigned char SegId;		// First packet segment id which is not received yet.
+		unsigned int Mask;		// Bit i is set if segment SegId + i is received.
+	};
+
+	// Type of packet on air (two lowest bits of first byte).
+	enum PacketType : unsigned char
+	{
+		PTPART,		// Part packet (PacketInfoPart).
+		PTINIT,		// Init packet (PacketInfoInit).
+		PTRSP,		// Acknowledge of one packet (PacketInfoRsp).
+		PTRSPWIN	// Acknowledge of window of packets (PacketInfoRspWin).
+	};
+
+	// Flags in first byte of packet on air.
+	const unsigned char PFTYPE = 0x03;	// Mask of packet type.
+	const unsigned char PFACK = 0x04;	// PacketInfoInit::Ack.
+	const unsigned char PFPOLL = 0x08;	// PacketInfoPart::Poll.
+	const unsigned char PFRESEND = 0x10;	// PacketInfoRsp::RequestResend.
+	const unsigned char PFCOMP = 0x20;	// PacketInfoInit::Compress.
+	const unsigned char PFEND = 0x40;	// PacketInfoPart::End.
+	const unsigned char PFSTREAM = 0x80;	// PacketInfoInit::Stream.
+
+	// Size of packet info on air [byte]. All multi byte fields are little endian.
+	// Part:	flags, session, segment id, size
+	// Init:	flags, session, segment id, size, local id, remote id, port, window, varint total size
+	// Rsp:		flags, session, segment id
+	// RspWin:	flags, session, segment id, mask (4 bytes)
+	const size_t SZ_INFO_PART = 4;
+	const size_t SZ_INFO_INIT = 8;
+	const size_t SZ_INFO_INIT_MAX = SZ_INFO_INIT + 5;
+	const size_t SZ_INFO_RSP = 3;
+	const size_t SZ_INFO_RSPWIN = 7;
+
+	static_assert(sizeof(unsigned int) >= 4, "PacketInfoRspWin::Mask must hold 32 bits");
+
+	// Get type of packet on air.
+	// pBuf: Pointer to received packet.
+	// sz: Size of received packet [byte].
+	// pType: Pointer where packet type will be stored.
+	// Returns true on success, false if packet is empty.
+	inline bool GetPacketType(const char *pBuf, size_t sz, PacketType *pType)
+	{
+		if (!sz)
+		{
+			return false;
+		}
+
+		*pType = static_cast<PacketType>(pBuf[0] & PFTYPE);
+		return true;
+	};
+
+	// Segment id on air of stream segment. Stream segments are numbered from 1 and segment id
+	// on air wraps from 255 to 1 (0 is reserved for init packet).
+	// seg: Stream segment number.
+	inline unsigned char WrapSegId(unsigned int seg)
+	{
+		return (seg - 1) % 255 + 1;
+	};
+
+	// Stream segment number of segment id on air which is nearest to reference segment
+	// (window of segments in flight must be smaller than half of segment id range).
+	// segId: Segment id on air (1 - 255).
+	// ref: Reference stream segment number.
+	// Returns stream segment number or 0 if it would be before first segment.
+	inline unsigned int UnwrapSegId(unsigned char segId, unsigned int ref)
+	{
+		int diff = (static_cast<int>(segId) - WrapSegId(ref) + 255) % 255;
+		if (diff > 127)
+		{
+			diff -= 255;
+		}
+
+		return diff < 0 && ref <= static_cast<unsigned int>(-diff) ? 0 : ref + diff;
+	};
+
+	// Size of init packet info on air [byte].
+	// pInfo: Pointer to packet info.
+	size_t GetSzInfoInit(const PacketInfoInit *pInfo);
+
+	// Encode packet info for transmission.
+	// pInfo: Pointer to packet info.
+	// pBuf: Pointer to buffer where packet info will be stored (at least SZ_INFO_INIT_MAX bytes).
+	// Returns size of encoded packet info [byte].
+	size_t EncodeInit(const PacketInfoInit *pInfo, char *pBuf);
+	size_t EncodePart(const PacketInfoPart *pInfo, char *pBuf);
+	size_t EncodeRsp(const PacketInfoRsp *pInfo, char *pBuf);
+	size_t EncodeRspWin(const PacketInfoRspWin *pInfo, char *pBuf);
+
+	// Decode received packet info. LocalId, RemoteId and Port are decoded only from init packet.
+	// pBuf: Pointer to received packet.
+	// sz: Size of received packet [byte].
+	// pInfo: Pointer where packet info will be stored.
+	// Returns size of packet info [byte] or 0 if packet is not of requested type or it is too short
+	// (segment id of init packet is always 0, segment id of part packet is never 0).
+	size_t DecodeInit(const char *pBuf, size_t sz, PacketInfoInit *pInfo);
+	size_t DecodePart(const char *pBuf, size_t sz, PacketInfoPart *pInfo);
+	size_t DecodeRsp(const char *pBuf, size_t sz, PacketInfoRsp *pInfo);
+	size_t DecodeRspWin(const char *pBuf, size_t sz, PacketInfoRspWin *pInfo);
+};
@@ -0,0 +1,269 @@
+#include <boost/program_options.hpp>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <iostream>
+#include <unistd.h>
+
+#include "capture.h"
+#include "comm.h"
+#include "emu.h"
+#include "clock.h"
+#include "packet.h"
+#include "log.h"
+
+#define WHITE "\033[0m"
+#define RED "\033[1;31m"
+
+using namespace std;
+using namespace RN;
+namespace po = boost::program_options;
+
+// Frame of capture which is sent again.
+struct Frame
+{
+	double Time;		// Time of frame relative to first replayed frame [second].
+	string Data;		// Frame as sent by radio.
+	bool Response;		// Peer responded to frame in capture (before next replayed frame).
+};
+
+// Time between start of reception and first frame, so receiving node is listening [second].
+static const double LEADIN = 0.5;
+
+void parse_args(int argc, char **argv, po::options_description &optDesc, po::variables_map &varMap);
+bool load_frames(const char *pFile, bool outbound, vector<Frame> *pFrames, PacketInfoInit *pInit);
+void play(RN2483 *pPlayer, const vector<Frame> *pFrames, double speed, atomic<size_t> *pSent, atomic<bool> *pDone);
+
+int main(int argc, char **argv)
+{
+	po::options_description desc;
+	po::variables_map vm;
+	parse_args(argc, argv, desc, vm);
+
+	if (vm.count("help") || !vm.count("capture"))
+	{
+		cout << desc << "\n";
+		return 0;
+	}
+
+	// node which sent first init packet of capture is replayed, its peer is Comm under test
+
+	vector<Frame> frames;
+	PacketInfoInit init;
+	bool okLoad = load_frames(vm["capture"].as<string>().data(), vm.count("outbound"), &frames, &init);
+	if (!okLoad)
+	{
+		cout << RED "[ERROR]" WHITE " Unable to read capture or capture has no init packet\n";
+		return -1;
+	}
+
+	Log::Start();
+
+	// both nodes share emulated link in this process, frames sent by Comm are received by player
+	// only where it waits for response
+
+	EmuLink link;
+	link.SetBaud(vm["baud"].as<unsigned int>());
+
+	bool okLink = link.Init(NULL, NULL);
+	if (!okLink)
+	{
+		cout << RED "[ERROR]" WHITE " Unable to open pseudo-terminals\n";
+		return -1;
+	}
+
+	volatile bool stop = false;
+	thread threadLink([&link, &stop]() { link.Run(&stop); });
+
+	Comm c;
+	RN2483 player;
+
+	PacketInfo info;
+	info.LocalId = init.RemoteId;
+	info.RemoteId = init.LocalId;
+	info.Port = init.Port;
+
+	bool okInit =
+		c.Init(link.GetDevice(0)->GetDevice()) &&
+		player.Init(link.GetDevice(1)->GetDevice()) &&
+		c.SetInfo(&info) &&
+		c.SetFEC(static_cast<unsigned char>(vm["fec"].as<int>())) &&
+		c.SetRetry(static_cast<unsigned char>(vm["retry"].as<int>()));
+
+	if (okInit && vm.count("bitrate"))
+	{
+		okInit = c.SetBitRate(vm["bitrate"].as<unsigned int>()) && player.SetBitRate(vm["bitrate"].as<unsigned int>());
+	}
+
+	if (!okInit)
+	{
+		cout << RED "[ERROR]" WHITE " Unable to initialize emulated devices\n";
+		stop = true;
+		threadLink.join();
+		return -1;
+	}
+
+	ofstream ofs;
+	ostringstream oss;
+	if (vm.count("output"))
+	{
+		ofs.open(vm["output"].as<string>().data(), fstream::out | fstream::binary | fstream::trunc);
+	}
+	ostream &os = vm.count("output") ? static_cast<ostream&>(ofs) : static_cast<ostream&>(oss);
+
+	LOG_OK("REPLAY START frames(%u) local(%u) remote(%u) port(%u) stream(%i)", frames.size(), info.LocalId,
+		info.RemoteId, info.Port, init.Stream);
+
+	atomic<size_t> sent(0);
+	atomic<bool> done(false);
+	thread threadPlay(play, &player, &frames, vm["speed"].as<double>(), &sent, &done);
+
+	// receiving runs until all frames are sent and Comm gives up on next message
+
+	Clock clk;
+	size_t messages = 0;
+	size_t failed = 0;
+	size_t received = 0;
+	vector<char> buf(c.GetMaxSz());
+	do
+	{
+		size_t szRX = 0;
+		bool okRX = init.Stream ? c.ReceiveStream(os, &szRX) : c.Receive(buf.data(), buf.size(), &szRX);
+		if (!okRX)
+		{
+			failed += szRX > 0;
+			continue;
+		}
+
+		if (!init.Stream)
+		{
+			os.write(buf.data(), szRX);
+		}
+
+		LOG_OK("REPLAY RECEIVE size(%u) time %f [second]", szRX, clk.Now());
+		messages++;
+		received += szRX;
+	} while (!done.load());
+
+	double time = clk.Now();
+	threadPlay.join();
+
+	LOG_OK("REPLAY END frames(%u/%u) messages(%u) failed(%u) size(%u)", sent.load(), frames.size(), messages, failed, received);
+	LOG_OK("Data received in %f [second] with mean bandwidth %u", time, static_cast<unsigned int>(static_cast<double>(received) / time));
+
+	c.PrintLatency();
+
+	stop = true;
+	threadLink.join();
+
+	Log::Stop();
+
+	return 0;
+}
+
+bool load_frames(const char *pFile, bool outbound, vector<Frame> *pFrames, PacketInfoInit *pInit)
+{
+	Capture capture;
+	if (!capture.Open(pFile))
+	{
+		return false;
+	}
+
+	bool init = false;
+	bool tx;
+	double time;
+	double first = 0.0;
+	string data;
+	while (capture.Read(&tx, &time, &data))
+	{
+		if (tx != outbound)
+		{
+			if (!pFrames->empty())
+			{
+				pFrames->back().Response = true;
+			}
+			continue;
+		}
+
+		init = init || DecodeInit(data.data(), data.size(), pInit);
+
+		if (pFrames->empty())
+		{
+			first = time;
+		}
+
+		Frame frame;
+		frame.Time = (time - first) / 1e6;
+		frame.Data.swap(data);
+		frame.Response = false;
+		pFrames->push_back(frame);
+	}
+
+	return init;
+}
+
+void play(RN2483 *pPlayer, const vector<Frame> *pFrames, double speed, atomic<size_t> *pSent, atomic<bool> *pDone)
+{
+	// frames keep their distance in capture divided by speed (0 sends them back to back), frame which
+	// is late because previous one was still on air is sent at once; link is half-duplex, so player
+	// waits for response where peer responded in capture (at most as long as captured node waited)
+	// and following frames are shifted by this wait
+
+	usleep(static_cast<useconds_t>(LEADIN * 1e6));
+
+	Clock clk;
+	double shift = 0.0;
+	vector<char> buf(1024);
+	for (size_t i = 0; i < pFrames->size(); i++)
+	{
+		const Frame &frame = (*pFrames)[i];
+		double wait = speed > 0.0 ? frame.Time / speed + shift - clk.Now() : 0.0;
+		if (wait > 0.0)
+		{
+			usleep(static_cast<useconds_t>(wait * 1e6));
+		}
+
+		bool okTX = pPlayer->TX(frame.Data.data(), frame.Data.size());
+		if (!okTX)
+		{
+			LOG_WARNING("REPLAY TX frame(%u) size(%u)", i, frame.Data.size());
+			continue;
+		}
+
+		pSent->fetch_add(1);
+
+		if (frame.Response && i + 1 < pFrames->size())
+		{
+			const Frame &next = (*pFrames)[i + 1];
+			if (!pPlayer->RX(buf.data(), buf.size(), next.Time - frame.Time))
+			{
+				LOG_WARNING("REPLAY RX frame(%u) no response", i);
+			}
+
+			double late = clk.Now() - (speed > 0.0 ? next.Time / speed : 0.0);
+			shift = late > shift ? late : shift;
+		}
+	}
+
+	pDone->store(true);
+}
+
+void parse_args(int argc, char **argv, po::options_description &optDesc, po::variables_map &varMap)
+{
+	optDesc.add_options()
+		("help,h", "Help screen")
+		("capture,c", po::value<string>(), "Capture file (pcap-ng) recorded by app --capture")
+		("outbound", "Replay frames sent by capturing node (received frames are replayed otherwise)")
+		("speed", po::value<double>()->default_value(1.0), "Speed-up of time between frames (0 sends frames back to back)")
+		("output,o", po::value<string>(), "Output file name into which received data will be stored")
+		("fec", po::value<int>()->default_value(0), "Number of Reed-Solomon parity bytes in each packet (as on captured link)")
+		("retry", po::value<int>()->default_value(4), "Number of retries of packet with doubled timeout")
+		("bitrate", po::value<unsigned int>(), "Bit rate of emulated radio [bit/second] (2500 if not set, higher rate shortens air time)")
+		("baud", po::value<unsigned int>()->default_value(57600), "UART baud rate of emulated devices (0 to disable)");
+
+	po::store(po::parse_command_line(argc, argv, optDesc), varMap);
+	po::notify(varMap);
+};
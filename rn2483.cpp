@@ -1,10 +1,16 @@
 #include "rn2483.h"
+#include "trace.h"
+#include "log.h"
+#include <cmath>
 #include <string>
 
 using namespace std;
 using namespace RN;
 
 const size_t RN2483::_szBuf = 1024;
+const double RN2483::_toCmd = 2.0;
+const size_t RN2483::_cmdMax = 8;
+const double RN2483::_toDrain = 0.1;
 
 const char RN2483::_DNULL[] = "\0\0";
 const char RN2483::_UVER[] = "Usys get ver\r\n";
@@ -14,6 +20,7 @@ const char RN2483::_OK[] = "ok\r\n";
 const char RN2483::_TXS[] = "radio tx ";
 const char RN2483::_TXOK[] = "radio_tx_ok\r\n";
 const char RN2483::_RX[] = "radio rx 0\r\n";
+const char RN2483::_RXSTOP[] = "radio rxstop\r\n";
 const char RN2483::_RXR[] = "radio_rx  ";
 const char RN2483::_RXE[] = "radio_err\r\n";
 const char RN2483::_RESET[] = "sys reset\r\n";
@@ -45,10 +52,28 @@ const char RN2483::_SETSYNC[] = "radio set sync ";
 const char RN2483::_GETSYNC[] = "radio get sync\r\n";
 const char RN2483::_INVLD[] = "invalid param\r\n";
 
+// modulation must be first, other settings are meaningful only with FSK
+const RN2483::Setting RN2483::_config[] =
+{
+	{ _SETMODFSK, NULL, _GETMOD, "fsk" },
+	{ _SETFREQ, "863500000", _GETFREQ, "863500000" },
+	{ _SETPWR, "5", _GETPWR, "5" },
+	{ _SETRATE, "2500", _GETRATE, "2500" },
+	{ _SETDS, "0.3", _GETDS, "0.3" },
+	{ _SETPRLEN, "8", _GETPRLEN, "8" },
+	{ _SETCRCOFF, NULL, _GETCRC, "off" },
+	{ _SETRXBW, "12.5", _GETRXBW, "12.5" },
+	{ _SETWDT, "5000", _GETWDT, "5000" },
+	{ _SETSYNC, "12", _GETSYNC, "12" }
+};
+
 RN2483::RN2483() :
 	_fd(-1),
+	_wdt(15000),
 	_pTX(new char[_szBuf + 1]),
-	_pRX(new char[_szBuf + 1])
+	_rxCont(false),
+	_rxOn(false),
+	_rxStart(false)
 {
 }
 
@@ -56,12 +81,11 @@ RN2483::~RN2483()
 {
 	close(_fd);
 	delete[] _pTX;
-	delete[] _pRX;
 }
 
-bool RN2483::Init()
+bool RN2483::Init(const char *pDevice, bool warm)
 {
-	_fd = open("/dev/ttyAMA0", O_RDWR | O_NOCTTY);
+	_fd = open(pDevice, O_RDWR | O_NOCTTY | O_NONBLOCK);
 	if (_fd == -1)
 	{
 		return false;
@@ -73,8 +97,9 @@ bool RN2483::Init()
 	options.c_iflag = IGNPAR;
 	options.c_oflag = 0;
 	options.c_cflag = CS8 | CLOCAL | CREAD;
-	options.c_lflag = ICANON;
-	options.c_cc[VEOL] = '\n';
+	options.c_lflag = 0;
+	options.c_cc[VMIN] = 0;
+	options.c_cc[VTIME] = 0;
 
 	rc = cfsetspeed(&options, B57600);
 	if (rc != 0)
@@ -115,7 +140,23 @@ bool RN2483::Init()
 	}
 
 	_write(_UVER, sizeof(_UVER) - 1);
-	_read(_pRX, _szBuf);
+	size_t szRead;
+	_read(&szRead);
+	// radio keeps its settings after previous process, reset is skipped if they match
+	if (warm)
+	{
+		bool okWarm = _warmStart();
+		if (okWarm)
+		{
+			return true;
+		}
+
+		// drop responses which may be left by fast path
+		while (_read(&szRead, _toDrain))
+		{
+		}
+	}
+
 	// reset device
 	bool rst = Reset();
 	if (!rst)
@@ -134,292 +175,130 @@ bool RN2483::Init()
 		return false;
 	}
 
-	// set modulation to FSK
-	Mod modulation;
-	bool okMod = SetMod(Mod::RNFSK);
-	if (!okMod)
+	// configure radio, commands are pipelined and each setting is verified by reading it back
+	for (size_t i = 0; i < sizeof(_config) / sizeof(_config[0]); i++)
 	{
-		return false;
-	}
-	okMod = GetMod(&modulation);
-	if (!okMod)
-	{
-		return false;
-	}
-
-	// set frequency for modulation
-	bool okFreq = SetFreq(863500000);
-	if (!okFreq)
-	{
-		return false;
+		_queue(_config[i].pSet, _config[i].pArg, "ok");
+		_queue(_config[i].pGet, NULL, _config[i].pValue);
 	}
 
-	unsigned int freq;
-	okFreq = GetFreq(&freq);
-	if (!okFreq)
+	bool okConfig = _flush();
+	if (!okConfig)
 	{
 		return false;
 	}
 
-	// set power
-	bool okPwr = SetPower(5);
-	if (!okPwr)
-	{
-		return false;
-	}
+	_wdt = 5000;
 
-	char pwr;
-	okPwr = GetPower(&pwr);
-	if (!okPwr)
-	{
-		return false;
-	}
-
-	// set bit rate
-	bool okRate = SetBitRate(2500);
-	if (!okRate)
-	{
-		return false;
-	}
-
-	unsigned int rate;
-	okRate = GetBitRate(&rate);
-	if (!okRate)
-	{
-		return false;
-	}
+	return true;
+}
 
-	// set data shaping parameter for FSK
-	bool okBT = SetDataShaping(RNDS0_3);
-	if (!okBT)
-	{
-		return false;
-	}
+bool RN2483::TX(const void *ptr, size_t sz)
+{
+	return _tx(ptr, sz, NULL, 0);
+}
 
-	DataShaping bt;
-	okBT = GetDataShaping(&bt);
-	if (!okBT)
-	{
-		return false;
-	}
+bool RN2483::TX(const void *ptr1, size_t sz1, const void *ptr2, size_t sz2)
+{
+	return _tx(ptr1, sz1, ptr2, sz2);
+}
 
-	// set preamble length
-	bool okPL = SetPreambleLength(8);
-	if (!okPL)
+size_t RN2483::RX(void *pDst, size_t szDst, double timeout)
+{
+	// frames received while other commands were processed are returned first
+	if (!_rxQueue.empty())
 	{
-		return false;
-	}
+		string frame;
+		frame.swap(_rxQueue.front());
+		_rxQueue.pop_front();
 
-	unsigned int len;
-	okPL = GetPreambleLength(&len);
-	if (!okPL)
-	{
-		return false;
-	}
+		if (frame.size() > szDst)
+		{
+			return 0;
+		}
 
-	// set CRC off
-	bool okCRC = SetCRC(false);
-	if (!okCRC)
-	{
-		return false;
+		memcpy(pDst, frame.data(), frame.size());
+		return frame.size();
 	}
 
-	bool crc;
-	okCRC = GetCRC(&crc);
-	if (!okCRC)
+	Clock clk;
+	if (timeout < 0.0)
 	{
-		return false;
+		timeout = _wdt / 1000.0 + _toCmd;
 	}
 
-	// set RX bandwidth
-	bool okRXBW = SetRXBW(RNRXBW12_5);
-	if (!okRXBW)
+	bool okStart = _startRX();
+	if (!okStart)
 	{
-		return false;
+		return 0;
 	}
 
-	RXBandWidth rxbw;
-	okRXBW = GetRXBW(&rxbw);
-	if (!okRXBW)
+	// first line is response to start of reception, reception keeps running after timeout
+	Trace::Span spanWait("rn2483", "wait radio_rx");
+	size_t szRead;
+	char *pLine;
+	do
 	{
-		return false;
-	}
+		double left = timeout - clk.Now();
+		pLine = _read(&szRead, left > 0.0 ? left : 0.0);
+		if (!pLine)
+		{
+			return 0;
+		}
 
-	// set watch dog timeout
-	bool okWDT = SetWDT(5000);
-	if (!okWDT)
-	{
-		return false;
-	}
+		if (_rxStart)
+		{
+			_rxStart = false;
+			if (bcmp(pLine, _OK) != 0)
+			{
+				_rxOn = false;
+				return 0;
+			}
+
+			pLine = NULL;
+		}
+	} while (!pLine);
+	spanWait.End();
 
-	unsigned int wdt;
-	okWDT = GetWDT(&wdt);
-	if (!okWDT)
+	// reception ends with received frame or error, start it again before frame is decoded
+	_rxOn = false;
+	if (_rxCont)
 	{
-		return false;
+		_startRX();
 	}
 
-	// set sync word
-	bool okSync = SetSync("12");
-	if (!okSync)
+	// if data is received
+	if (bcmp(pLine, _RXR) == 0)
 	{
-		return false;
+		Trace::Span spanHex("rn2483", "unhex", szRead);
+		return _decodeRX(pLine, szRead, static_cast<char*>(pDst), szDst);
 	}
-	char sync[9];
-	okSync = GetSync(sync, sizeof(sync) - 1);
-	if (!okSync)
+	else if (bcmp(pLine, _RXE) == 0)
 	{
-		return false;
+		return 0;
 	}
 
-	return true;
+	return 0;
 }
 
-bool RN2483::TX(const void *ptr, size_t sz)
+const Histogram &RN2483::GetTXLatency()
 {
-	// translate data
-	size_t szHex = D2H(static_cast<const char*>(ptr), sz, _pTX);
-
-	// transmit data
-	bool okWrite = _write(_TXS, sizeof(_TXS) - 1);
-	if (!okWrite)
-	{
-		return false;
-	}
-
-	okWrite = _write(_pTX, szHex);
-	if (!okWrite)
-	{
-		return false;
-	}
-
-	okWrite = _write(_END, sizeof(_END) - 1);
-	if (!okWrite)
-	{
-		return false;
-	}
-	// receive ok status
-	size_t szRead = _read(_pRX, _szBuf);
-	if (szRead == 0)
-	{
-		return false;
-	}
-	_pRX[szRead] = '\0';
-	if (bcmp(_pRX, _OK) != 0)
-	{
-		return false;
-	}
-	szRead = _read(_pRX, _szBuf);
-	if (szRead <= 0)
-	{
-		return false;
-	}
-	_pRX[szRead] = '\0';
-
-	if (bcmp(_pRX, _TXOK) != 0)
-	{
-		return false;
-	}
-
-	return true;
+	return _txLatency;
 }
 
-bool RN2483::TX(const void *ptr1, size_t sz1, const void *ptr2, size_t sz2)
+bool RN2483::SetCapture(const char *pFile)
 {
-	// transmit data
-	bool okWrite = _write(_TXS, sizeof(_TXS) - 1);
-	if (!okWrite)
-	{
-		return false;
-	}
-	
-	// translate and send first data segment
-	size_t szHex = D2H(static_cast<const char*>(ptr1), sz1, _pTX);
-	okWrite = _write(_pTX, szHex);
-	if (!okWrite)
+	if (!pFile)
 	{
-		return false;
+		return _capture.Close();
 	}
 
-	// translate and send second data segment
-	szHex = D2H(static_cast<const char*>(ptr2), sz2, _pTX);
-	okWrite = _write(_pTX, szHex);
-	if (!okWrite)
-	{
-		return false;
-	}
-
-	okWrite = _write(_END, sizeof(_END) - 1);
-	if (!okWrite)
-	{
-		return false;
-	}
-	// receive ok status
-	size_t szRead = _read(_pRX, _szBuf);
-	if (szRead == 0)
-	{
-		return false;
-	}
-	_pRX[szRead] = '\0';
-	if (bcmp(_pRX, _OK) != 0)
-	{
-		return false;
-	}
-	szRead = _read(_pRX, _szBuf);
-	if (szRead <= 0)
-	{
-		return false;
-	}
-	_pRX[szRead] = '\0';
-
-	if (bcmp(_pRX, _TXOK) != 0)
-	{
-		return false;
-	}
-
-	return true;
+	return _capture.Create(pFile);
 }
 
-size_t RN2483::RX(void *pDst, size_t szDst)
+void RN2483::SetContinuousRX(bool state)
 {
-	bool okWrite = _write(_RX, sizeof(_RX) - 1);
-	if (!okWrite)
-	{
-		return 0;
-	}
-
-	size_t szRead = _read(_pRX, _szBuf);
-	if (szRead == 0)
-	{
-		return 0;
-	}
-	_pRX[szRead] = '\0';
-	if (bcmp(_pRX, _OK) != 0)
-	{
-		return 0;
-	}
-	szRead = _read(_pRX, _szBuf);
-	if (szRead <= 0)
-	{
-		return 0;
-	}
-	_pRX[szRead] = '\0';
-
-	// if data is received
-	if (bcmp(_pRX, _RXR) == 0)
-	{
-		return H2D(
-			_pRX + sizeof(_RXR) - 1,
-			szRead - (sizeof(_RXR) - 1) - 2,
-			static_cast<char*>(pDst),
-			szDst);
-	}
-	else if (bcmp(_pRX, _RXE) == 0)
-	{
-		return 0;
-	}
-
-	return 0;
+	_rxCont = state;
 }
 
 unsigned int RN2483::SetMACPause()
@@ -430,15 +309,15 @@ unsigned int RN2483::SetMACPause()
 		return false;
 	}
 
-	size_t szRead = _read(_pRX, _szBuf);
-	if (szRead == 0)
+	size_t szRead;
+	char *pLine = _read(&szRead);
+	if (!pLine)
 	{
 		return false;
 	}
-	_pRX[szRead] = '\0';
 	
 	unsigned int time = 0;
-	int retrieved = sscanf(_pRX, "%u", &time);
+	int retrieved = sscanf(pLine, "%u", &time);
 
 	if (retrieved != 1)
 	{
@@ -456,14 +335,14 @@ bool RN2483::SetMACResume()
 		return false;
 	}
 
-	size_t szRead = _read(_pRX, _szBuf);
-	if (szRead == 0)
+	size_t szRead;
+	char *pLine = _read(&szRead);
+	if (!pLine)
 	{
 		return false;
 	}
-	_pRX[szRead] = '\0';
 	
-	if (bcmp(_pRX, _OK) != 0)
+	if (bcmp(pLine, _OK) != 0)
 	{
 		return false;
 	}
@@ -479,17 +358,22 @@ bool RN2483::Reset()
 		return false;
 	}
 
-	size_t szRead = _read(_pRX, _szBuf);
-	if (szRead == 0)
+	size_t szRead;
+	char *pLine = _read(&szRead);
+	if (!pLine)
 	{
 		return false;
 	}
-	_pRX[szRead] = '\0';
 
-	if (bcmp(_pRX, _RESET_ACK) != 0)
+	if (bcmp(pLine, _RESET_ACK) != 0)
 	{
 		return false;
 	}
+
+	// reset restores default watch dog timeout and stops reception
+	_wdt = 15000;
+	_rxOn = _rxStart = false;
+	_rxQueue.clear();
 	return true;	
 }
 
@@ -509,14 +393,14 @@ bool RN2483::SetMod(Mod modulation)
 		return false;
 	}
 
-	size_t szRead = _read(_pRX, _szBuf);
-	if (szRead == 0)
+	size_t szRead;
+	char *pLine = _read(&szRead);
+	if (!pLine)
 	{
 		return false;
 	}
-	_pRX[szRead] = '\0';
 
-	if (bcmp(_pRX, _OK) != 0)
+	if (bcmp(pLine, _OK) != 0)
 	{
 	}
 
@@ -531,19 +415,19 @@ bool RN2483::GetMod(Mod *pModulation)
 		return false;
 	}
 
-	size_t szRead = _read(_pRX, _szBuf);
-	if (szRead == 0)
+	size_t szRead;
+	char *pLine = _read(&szRead);
+	if (!pLine)
 	{
 		return false;
 	}
-	_pRX[szRead] = '\0';
 
-	if (bcmp(_pRX, _GETMODFSK) == 0)
+	if (bcmp(pLine, _GETMODFSK) == 0)
 	{
 		*pModulation = Mod::RNFSK;
 		return true;
 	}
-	else if (bcmp(_pRX, _GETMODLORA) == 0)
+	else if (bcmp(pLine, _GETMODLORA) == 0)
 	{
 		*pModulation = Mod::RNLORA;
 		return true;
@@ -554,32 +438,27 @@ bool RN2483::GetMod(Mod *pModulation)
 
 bool RN2483::SetFreq(unsigned int freq)
 {
-	bool okWrite = _write(_SETFREQ, sizeof(_SETFREQ) - 1);
-	if (!okWrite)
-	{
-		return false;
-	}
-	
-	int i = sprintf(_pTX, "%u\r\n", freq);
+	char arg[16];
+	int i = snprintf(arg, sizeof(arg), "%u", freq);
 	if (i <= 0)
 	{
 		return false;
 	}
 
-	okWrite = _write(_pTX, i);
+	bool okWrite = _writeCmd(_SETFREQ, arg);
 	if (!okWrite)
 	{
 		return false;
 	}
 
-	size_t szRead = _read(_pRX, _szBuf);
-	if (szRead == 0)
+	size_t szRead;
+	char *pLine = _read(&szRead);
+	if (!pLine)
 	{
 		return false;
 	}
-	_pRX[szRead] = '\0';
 
-	if (bcmp(_pRX, _OK) != 0)
+	if (bcmp(pLine, _OK) != 0)
 	{
 		return false;
 	}
@@ -595,15 +474,15 @@ bool RN2483::GetFreq(unsigned int *pFreq)
 		return false;
 	}
 
-	size_t szRead = _read(_pRX, _szBuf);
-	if (szRead == 0)
+	size_t szRead;
+	char *pLine = _read(&szRead);
+	if (!pLine)
 	{
 		return false;
 	}
-	_pRX[szRead] = '\0';
 
 	unsigned int freq;
-	int i = sscanf(_pRX, "%u", &freq);
+	int i = sscanf(pLine, "%u", &freq);
 	if (i != 1)
 	{
 		return false;
@@ -614,31 +493,27 @@ bool RN2483::GetFreq(unsigned int *pFreq)
 
 bool RN2483::SetPower(char power)
 {
-	bool okWrite = _write(_SETPWR, sizeof(_SETPWR) - 1);
-	if (!okWrite)
-	{
-		return false;
-	}
-	int i = sprintf(_pTX, "%hhi\r\n", power);
+	char arg[16];
+	int i = snprintf(arg, sizeof(arg), "%hhi", power);
 	if (i <= 0)
 	{
 		return false;
 	}
 
-	okWrite = _write(_pTX, i);
+	bool okWrite = _writeCmd(_SETPWR, arg);
 	if (!okWrite)
 	{
 		return false;
 	}
 
-	size_t szRead = _read(_pRX, _szBuf);
-	if (szRead == 0)
+	size_t szRead;
+	char *pLine = _read(&szRead);
+	if (!pLine)
 	{
 		return false;
 	}
-	_pRX[szRead] = '\0';
 
-	if (bcmp(_pRX, _OK) != 0)
+	if (bcmp(pLine, _OK) != 0)
 	{
 		return false;
 	}
@@ -654,15 +529,15 @@ bool RN2483::GetPower(char *pPower)
 		return false;
 	}
 	
-	size_t szRead = _read(_pRX, _szBuf);
-	if (szRead == 0)
+	size_t szRead;
+	char *pLine = _read(&szRead);
+	if (!pLine)
 	{
 		return false;
 	}
-	_pRX[szRead] = '\0';
 
 	char pwr;
-	int i = sscanf(_pRX, "%hhi", &pwr);
+	int i = sscanf(pLine, "%hhi", &pwr);
 	if (i != 1)
 	{
 		return false;
@@ -675,31 +550,27 @@ bool RN2483::GetPower(char *pPower)
 
 bool RN2483::SetBitRate(unsigned int rate)
 {
-	bool okWrite = _write(_SETRATE, sizeof(_SETRATE) - 1);
-	if (!okWrite)
-	{
-		return false;
-	}
-	int i = sprintf(_pTX, "%u\r\n", rate);
+	char arg[16];
+	int i = snprintf(arg, sizeof(arg), "%u", rate);
 	if (i <= 0)
 	{
 		return false;
 	}
 
-	okWrite = _write(_pTX, i);
+	bool okWrite = _writeCmd(_SETRATE, arg);
 	if (!okWrite)
 	{
 		return false;
 	}
 
-	size_t szRead = _read(_pRX, _szBuf);
-	if (szRead == 0)
+	size_t szRead;
+	char *pLine = _read(&szRead);
+	if (!pLine)
 	{
 		return false;
 	}
-	_pRX[szRead] = '\0';
 
-	if (bcmp(_pRX, _OK) != 0)
+	if (bcmp(pLine, _OK) != 0)
 	{
 		return false;
 	}
@@ -715,15 +586,15 @@ bool RN2483::GetBitRate(unsigned int *pRate)
 		return false;
 	}
 	
-	size_t szRead = _read(_pRX, _szBuf);
-	if (szRead == 0)
+	size_t szRead;
+	char *pLine = _read(&szRead);
+	if (!pLine)
 	{
 		return false;
 	}
-	_pRX[szRead] = '\0';
 
 	unsigned int rate;
-	int i = sscanf(_pRX, "%u", &rate);
+	int i = sscanf(pLine, "%u", &rate);
 	if (i != 1)
 	{
 		return false;
@@ -736,36 +607,42 @@ bool RN2483::GetBitRate(unsigned int *pRate)
 
 bool RN2483::SetDataShaping(DataShaping param)
 {
-	bool okWrite = _write(_SETDS, sizeof(_SETDS) - 1);
-	if (!okWrite)
-	{
-		return false;
-	}
-
+	const char *pArg = NULL;
 	switch (param)
 	{
 		case RNDS1_0:
-			_write("1.0\r\n", sizeof("1.0\r\n") - 1);
+			pArg = "1.0";
 			break;
 		case RNDS0_5:
-			_write("0.5\r\n", sizeof("0.5\r\n") - 1);
+			pArg = "0.5";
 			break;
 		case RNDS0_3:
-			_write("0.3\r\n", sizeof("0.3\r\n") - 1);
+			pArg = "0.3";
 			break;
 		case RNDSNone:
-			_write("none\r\n", sizeof("none\r\n") - 1);
+			pArg = "none";
 			break;
 	}
 
-	size_t szRead = _read(_pRX, _szBuf);
-	if (szRead == 0)
+	if (!pArg)
+	{
+		return false;
+	}
+
+	bool okWrite = _writeCmd(_SETDS, pArg);
+	if (!okWrite)
+	{
+		return false;
+	}
+
+	size_t szRead;
+	char *pLine = _read(&szRead);
+	if (!pLine)
 	{
 		return false;
 	}
-	_pRX[szRead] = '\0';
 
-	if (bcmp(_pRX, _OK) != 0)
+	if (bcmp(pLine, _OK) != 0)
 	{
 		return false;
 	}
@@ -781,26 +658,26 @@ bool RN2483::GetDataShaping(DataShaping *pParam)
 		return false;
 	}
 	
-	size_t szRead = _read(_pRX, _szBuf);
-	if (szRead == 0)
+	size_t szRead;
+	char *pLine = _read(&szRead);
+	if (!pLine)
 	{
 		return false;
 	}
-	_pRX[szRead] = '\0';
 
-	if (bcmp(_pRX, "1.0") == 0)
+	if (bcmp(pLine, "1.0") == 0)
 	{
 		*pParam = RNDS1_0;
 	}
-	else if (bcmp(_pRX, "0.5") == 0)
+	else if (bcmp(pLine, "0.5") == 0)
 	{
 		*pParam = RNDS0_5;
 	}
-	else if (bcmp(_pRX, "0.3") == 0)
+	else if (bcmp(pLine, "0.3") == 0)
 	{
 		*pParam = RNDS0_3;
 	}
-	else if (bcmp(_pRX, "none") == 0)
+	else if (bcmp(pLine, "none") == 0)
 	{
 		*pParam = RNDSNone;
 	}
@@ -814,31 +691,27 @@ bool RN2483::GetDataShaping(DataShaping *pParam)
 
 bool RN2483::SetPreambleLength(unsigned int length)
 {
-	bool okWrite = _write(_SETPRLEN, sizeof(_SETPRLEN) - 1);
-	if (!okWrite)
-	{
-		return false;
-	}
-	int i = sprintf(_pTX, "%u\r\n", length);
+	char arg[16];
+	int i = snprintf(arg, sizeof(arg), "%u", length);
 	if (i <= 0)
 	{
 		return false;
 	}
 
-	okWrite = _write(_pTX, i);
+	bool okWrite = _writeCmd(_SETPRLEN, arg);
 	if (!okWrite)
 	{
 		return false;
 	}
 
-	size_t szRead = _read(_pRX, _szBuf);
-	if (szRead == 0)
+	size_t szRead;
+	char *pLine = _read(&szRead);
+	if (!pLine)
 	{
 		return false;
 	}
-	_pRX[szRead] = '\0';
 
-	if (bcmp(_pRX, _OK) != 0)
+	if (bcmp(pLine, _OK) != 0)
 	{
 		return false;
 	}
@@ -854,15 +727,15 @@ bool RN2483::GetPreambleLength(unsigned int *pLength)
 		return false;
 	}
 	
-	size_t szRead = _read(_pRX, _szBuf);
-	if (szRead == 0)
+	size_t szRead;
+	char *pLine = _read(&szRead);
+	if (!pLine)
 	{
 		return false;
 	}
-	_pRX[szRead] = '\0';
 
 	unsigned int len;
-	int i = sscanf(_pRX, "%u", &len);
+	int i = sscanf(pLine, "%u", &len);
 	if (i != 1)
 	{
 		return false;
@@ -889,14 +762,14 @@ bool RN2483::SetCRC(bool state)
 		return false;
 	}
 
-	size_t szRead = _read(_pRX, _szBuf);
-	if (szRead == 0)
+	size_t szRead;
+	char *pLine = _read(&szRead);
+	if (!pLine)
 	{
 		return false;
 	}
-	_pRX[szRead] = '\0';
 
-	if (bcmp(_pRX, _OK) != 0)
+	if (bcmp(pLine, _OK) != 0)
 	{
 	}
 
@@ -911,19 +784,19 @@ bool RN2483::GetCRC(bool *pState)
 		return false;
 	}
 
-	size_t szRead = _read(_pRX, _szBuf);
-	if (szRead == 0)
+	size_t szRead;
+	char *pLine = _read(&szRead);
+	if (!pLine)
 	{
 		return false;
 	}
-	_pRX[szRead] = '\0';
 
-	if (bcmp(_pRX, "on") == 0)
+	if (bcmp(pLine, "on") == 0)
 	{
 		*pState = true;
 		return true;
 	}
-	else if (bcmp(_pRX, "off") == 0)
+	else if (bcmp(pLine, "off") == 0)
 	{
 		*pState = false;
 		return true;
@@ -934,107 +807,113 @@ bool RN2483::GetCRC(bool *pState)
 
 bool RN2483::SetRXBW(RXBandWidth param)
 {
-	bool okWrite = _write(_SETRXBW, sizeof(_SETRXBW) - 1);
-	if (!okWrite)
-	{
-		return false;
-	}
-
+	const char *pArg = NULL;
 	switch (param)
 	{
 		case RNRXBW250:
-			_write("250\r\n", sizeof("250\r\n") - 1);
+			pArg = "250";
 			break;
 
 		case RNRXBW125:
-			_write("125\r\n", sizeof("125\r\n") - 1);
+			pArg = "125";
 			break;
 
 		case RNRXBW62_5:
-			_write("62.5\r\n", sizeof("62.5\r\n") - 1);
+			pArg = "62.5";
 			break;
 
 		case RNRXBW31_3:
-			_write("31.3\r\n", sizeof("31.3\r\n") - 1);
+			pArg = "31.3";
 			break;
 
 		case RNRXBW15_6:
-			_write("15.6\r\n", sizeof("15.6\r\n") - 1);
+			pArg = "15.6";
 			break;
 
 		case RNRXBW7_8:
-			_write("7.8\r\n", sizeof("7.8\r\n") - 1);
+			pArg = "7.8";
 			break;
 
 		case RNRXBW3_9:
-			_write("3.9\r\n", sizeof("3.9\r\n") - 1);
+			pArg = "3.9";
 			break;
 
 		case RNRXBW200:
-			_write("200\r\n", sizeof("200\r\n") - 1);
+			pArg = "200";
 			break;
 
 		case RNRXBW100:
-			_write("100\r\n", sizeof("100\r\n") - 1);
+			pArg = "100";
 			break;
 
 		case RNRXBW50:
-			_write("50\r\n", sizeof("50\r\n") - 1);
+			pArg = "50";
 			break;
 
 		case RNRXBW25:
-			_write("25\r\n", sizeof("25\r\n") - 1);
+			pArg = "25";
 			break;
 
 		case RNRXBW12_5:
-			_write("12.5\r\n", sizeof("12.5\r\n") - 1);
+			pArg = "12.5";
 			break;
 
 		case RNRXBW6_3:
-			_write("6.3\r\n", sizeof("6.3\r\n") - 1);
+			pArg = "6.3";
 			break;
 
 		case RNRXBW3_1:
-			_write("3.1\r\n", sizeof("3.1\r\n") - 1);
+			pArg = "3.1";
 			break;
 
 		case RNRXBW166_7:
-			_write("166.7\r\n", sizeof("166.7\r\n") - 1);
+			pArg = "166.7";
 			break;
 
 		case RNRXBW83_3:
-			_write("83.3\r\n", sizeof("83.3\r\n") - 1);
+			pArg = "83.3";
 			break;
 
 		case RNRXBW41_7:
-			_write("41.7\r\n", sizeof("41.7\r\n") - 1);
+			pArg = "41.7";
 			break;
 
 		case RNRXBW20_8:
-			_write("20.8\r\n", sizeof("20.8\r\n") - 1);
+			pArg = "20.8";
 			break;
 
 		case RNRXBW10_4:
-			_write("10.4\r\n", sizeof("10.4\r\n") - 1);
+			pArg = "10.4";
 			break;
 
 		case RNRXBW5_2:
-			_write("5.2\r\n", sizeof("5.2\r\n") - 1);
+			pArg = "5.2";
 			break;
 
 		case RNRXBW2_6:
-			_write("2.6\r\n", sizeof("2.6\r\n") - 1);
+			pArg = "2.6";
 			break;
 	}
 
-	size_t szRead = _read(_pRX, _szBuf);
-	if (szRead == 0)
+	if (!pArg)
 	{
 		return false;
 	}
-	_pRX[szRead] = '\0';
 
-	if (bcmp(_pRX, _OK) != 0)
+	bool okWrite = _writeCmd(_SETRXBW, pArg);
+	if (!okWrite)
+	{
+		return false;
+	}
+
+	size_t szRead;
+	char *pLine = _read(&szRead);
+	if (!pLine)
+	{
+		return false;
+	}
+
+	if (bcmp(pLine, _OK) != 0)
 	{
 		return false;
 	}
@@ -1050,94 +929,94 @@ bool RN2483::GetRXBW(RXBandWidth *pParam)
 		return false;
 	}
 	
-	size_t szRead = _read(_pRX, _szBuf);
-	if (szRead == 0)
+	size_t szRead;
+	char *pLine = _read(&szRead);
+	if (!pLine)
 	{
 		return false;
 	}
-	_pRX[szRead] = '\0';
 
-	if (bcmp(_pRX, "250") == 0)
+	if (bcmp(pLine, "250") == 0)
 	{
 	        *pParam = RNRXBW250;
 	}
-	else if (bcmp(_pRX, "125") == 0)
+	else if (bcmp(pLine, "125") == 0)
 	{
 	        *pParam = RNRXBW125;
 	}
-	else if (bcmp(_pRX, "62.5") == 0)
+	else if (bcmp(pLine, "62.5") == 0)
 	{
 	        *pParam = RNRXBW62_5;
 	}
-	else if (bcmp(_pRX, "31.3") == 0)
+	else if (bcmp(pLine, "31.3") == 0)
 	{
 	        *pParam = RNRXBW31_3;
 	}
-	else if (bcmp(_pRX, "15.6") == 0)
+	else if (bcmp(pLine, "15.6") == 0)
 	{
 	        *pParam = RNRXBW15_6;
 	}
-	else if (bcmp(_pRX, "7.8") == 0)
+	else if (bcmp(pLine, "7.8") == 0)
 	{
 	        *pParam = RNRXBW7_8;
 	}
-	else if (bcmp(_pRX, "3.9") == 0)
+	else if (bcmp(pLine, "3.9") == 0)
 	{
 	        *pParam = RNRXBW3_9;
 	}
-	else if (bcmp(_pRX, "200") == 0)
+	else if (bcmp(pLine, "200") == 0)
 	{
 	        *pParam = RNRXBW200;
 	}
-	else if (bcmp(_pRX, "100") == 0)
+	else if (bcmp(pLine, "100") == 0)
 	{
 	        *pParam = RNRXBW100;
 	}
-	else if (bcmp(_pRX, "50") == 0)
+	else if (bcmp(pLine, "50") == 0)
 	{
 	        *pParam = RNRXBW50;
 	}
-	else if (bcmp(_pRX, "25") == 0)
+	else if (bcmp(pLine, "25") == 0)
 	{
 	        *pParam = RNRXBW25;
 	}
-	else if (bcmp(_pRX, "12.5") == 0)
+	else if (bcmp(pLine, "12.5") == 0)
 	{
 	        *pParam = RNRXBW12_5;
 	}
-	else if (bcmp(_pRX, "6.3") == 0)
+	else if (bcmp(pLine, "6.3") == 0)
 	{
 	        *pParam = RNRXBW6_3;
 	}
-	else if (bcmp(_pRX, "3.1") == 0)
+	else if (bcmp(pLine, "3.1") == 0)
 	{
 	        *pParam = RNRXBW3_1;
 	}
-	else if (bcmp(_pRX, "166.7") == 0)
+	else if (bcmp(pLine, "166.7") == 0)
 	{
 	        *pParam = RNRXBW166_7;
 	}
-	else if (bcmp(_pRX, "83.3") == 0)
+	else if (bcmp(pLine, "83.3") == 0)
 	{
 	        *pParam = RNRXBW83_3;
 	}
-	else if (bcmp(_pRX, "41.7") == 0)
+	else if (bcmp(pLine, "41.7") == 0)
 	{
 	        *pParam = RNRXBW41_7;
 	}
-	else if (bcmp(_pRX, "20.8") == 0)
+	else if (bcmp(pLine, "20.8") == 0)
 	{
 	        *pParam = RNRXBW20_8;
 	}
-	else if (bcmp(_pRX, "10.4") == 0)
+	else if (bcmp(pLine, "10.4") == 0)
 	{
 	        *pParam = RNRXBW10_4;
 	}
-	else if (bcmp(_pRX, "5.2") == 0)
+	else if (bcmp(pLine, "5.2") == 0)
 	{
 	        *pParam = RNRXBW5_2;
 	}
-	else if (bcmp(_pRX, "2.6") == 0)
+	else if (bcmp(pLine, "2.6") == 0)
 	{
 	        *pParam = RNRXBW2_6;
 	}
@@ -1151,35 +1030,40 @@ bool RN2483::GetRXBW(RXBandWidth *pParam)
 
 bool RN2483::SetWDT(unsigned int timeOut)
 {
-	bool okWrite = _write(_SETWDT, sizeof(_SETWDT) - 1);
-	if (!okWrite)
+	// running reception keeps old timeout
+	bool okStop = _stopRX();
+	if (!okStop)
 	{
 		return false;
 	}
-	int i = sprintf(_pTX, "%u\r\n", timeOut);
+
+	char arg[16];
+	int i = snprintf(arg, sizeof(arg), "%u", timeOut);
 	if (i <= 0)
 	{
 		return false;
 	}
 
-	okWrite = _write(_pTX, i);
+	bool okWrite = _writeCmd(_SETWDT, arg);
 	if (!okWrite)
 	{
 		return false;
 	}
 
-	size_t szRead = _read(_pRX, _szBuf);
-	if (szRead == 0)
+	size_t szRead;
+	char *pLine = _read(&szRead);
+	if (!pLine)
 	{
 		return false;
 	}
-	_pRX[szRead] = '\0';
 
-	if (bcmp(_pRX, _OK) != 0)
+	if (bcmp(pLine, _OK) != 0)
 	{
 		return false;
 	}
 
+	_wdt = timeOut;
+
 	return true;
 }
 
@@ -1191,101 +1075,431 @@ bool RN2483::GetWDT(unsigned int *pTimeOut)
 		return false;
 	}
 	
-	size_t szRead = _read(_pRX, _szBuf);
-	if (szRead == 0)
+	size_t szRead;
+	char *pLine = _read(&szRead);
+	if (!pLine)
 	{
 		return false;
 	}
-	_pRX[szRead] = '\0';
 
 	unsigned int wdt;
-	int i = sscanf(_pRX, "%u", &wdt);
+	int i = sscanf(pLine, "%u", &wdt);
 	if (i != 1)
 	{
 		return false;
 	}
 
-	*pTimeOut = wdt;
+	*pTimeOut = _wdt = wdt;
 
 	return true;
 }
 
 bool RN2483::SetSync(const char *pSync)
 {
-	bool okWrite = _write(_SETSYNC, sizeof(_SETSYNC) - 1);
+	bool okWrite = _writeCmd(_SETSYNC, pSync);
 	if (!okWrite)
 	{
 		return false;
 	}
 
-	okWrite = _write(pSync, strlen(pSync));
-	if (!okWrite)
+	size_t szRead;
+	char *pLine = _read(&szRead);
+	if (!pLine)
 	{
 		return false;
 	}
 
-	okWrite = _write("\r\n", sizeof("\r\n") - 1);
+	if (bcmp(pLine, _OK) != 0)
+	{
+		return false;
+	}
+
+	return true;
+}
+
+bool RN2483::GetSync(char *pSync, size_t szMax)
+{
+	bool okWrite = _write(_GETSYNC, sizeof(_GETSYNC) - 1);
 	if (!okWrite)
 	{
 		return false;
 	}
+	
+	size_t szRead;
+	char *pLine = _read(&szRead);
+	if (!pLine)
+	{
+		return false;
+	}
 
-	size_t szRead = _read(_pRX, _szBuf);
-	if (szRead == 0)
+	if (szRead > szMax - 1)
 	{
 		return false;
 	}
-	_pRX[szRead] = '\0';
 
-	if (bcmp(_pRX, _OK) != 0)
+	memcpy(pSync, pLine, szRead);
+	pSync[szRead] = '\0';
+
+	return true;
+}
+
+bool RN2483::_warmStart()
+{
+	// reception started by previous process may still run
+	vector<string> rsp;
+	_queue(_RXSTOP, NULL, "ok");
+	for (size_t i = 0; i < sizeof(_config) / sizeof(_config[0]); i++)
+	{
+		_queue(_config[i].pGet, NULL, NULL);
+	}
+
+	bool okGet = _flush(&rsp);
+	if (!okGet)
 	{
 		return false;
 	}
 
+	// device with other modulation was reset or powered up, its MAC stack is not paused
+	if (rsp[1] != _config[0].pValue)
+	{
+		return false;
+	}
+
+	// set only values which differ
+	for (size_t i = 1; i < sizeof(_config) / sizeof(_config[0]); i++)
+	{
+		if (rsp[i + 1] != _config[i].pValue)
+		{
+			_queue(_config[i].pSet, _config[i].pArg, "ok");
+			_queue(_config[i].pGet, NULL, _config[i].pValue);
+		}
+	}
+
+	bool okConfig = _flush();
+	if (!okConfig)
+	{
+		return false;
+	}
+
+	_wdt = 5000;
+	_rxOn = _rxStart = false;
 	return true;
 }
 
-bool RN2483::GetSync(char *pSync, size_t szMax)
+void RN2483::_queue(const char *pCmd, const char *pArg, const char *pRsp)
 {
-	bool okWrite = _write(_GETWDT, sizeof(_GETWDT) - 1);
+	Cmd cmd;
+	cmd.Line = pCmd;
+	if (pArg)
+	{
+		cmd.Line += pArg;
+		cmd.Line += _END;
+	}
+	cmd.Check = pRsp != NULL;
+	if (pRsp)
+	{
+		cmd.Rsp = pRsp;
+	}
+
+	_cmds.push_back(cmd);
+}
+
+bool RN2483::_flush(vector<string> *pRsp)
+{
+	// device answers commands in order, next command is written while response of previous one is pending
+	bool okAll = true;
+	size_t sent = 0;
+	for (size_t i = 0; i < _cmds.size(); i++)
+	{
+		// commands which fit into window are written at once
+		string batch;
+		for (; sent < _cmds.size() && sent < i + _cmdMax; sent++)
+		{
+			batch += _cmds[sent].Line;
+		}
+
+		if (!batch.empty())
+		{
+			bool okWrite = _write(batch.data(), batch.size());
+			if (!okWrite)
+			{
+				_cmds.clear();
+				return false;
+			}
+		}
+
+		size_t szRead;
+		char *pLine = _read(&szRead);
+		if (!pLine)
+		{
+			LOG_ERROR("RN2483 command(%s), response timeout", _cmds[i].Line.substr(0, _cmds[i].Line.size() - 2).data());
+			_cmds.clear();
+			return false;
+		}
+
+		if (pRsp)
+		{
+			pRsp->push_back(pLine);
+		}
+
+		if (_cmds[i].Check && _cmds[i].Rsp != pLine)
+		{
+			LOG_ERROR("RN2483 command(%s), response(%s), expected(%s)",
+				_cmds[i].Line.substr(0, _cmds[i].Line.size() - 2).data(), pLine, _cmds[i].Rsp.data());
+			okAll = false;
+		}
+	}
+
+	_cmds.clear();
+	return okAll;
+}
+
+bool RN2483::_startRX()
+{
+	if (_rxOn)
+	{
+		return true;
+	}
+
+	bool okWrite = _write(_RX, sizeof(_RX) - 1);
 	if (!okWrite)
 	{
 		return false;
 	}
-	
-	size_t szRead = _read(_pRX, _szBuf);
-	if (szRead == 0)
+
+	_rxOn = _rxStart = true;
+	return true;
+}
+
+bool RN2483::_stopRX()
+{
+	if (!_rxOn)
+	{
+		return true;
+	}
+
+	bool okWrite = _write(_RXSTOP, sizeof(_RXSTOP) - 1);
+	if (!okWrite)
 	{
 		return false;
 	}
-	_pRX[szRead] = '\0';
 
-	if (szRead - 2 > szMax - 1)
+	// response to start of reception and frame which ended before stop precede response to stop
+	size_t szRead;
+	char *pLine;
+	while (true)
+	{
+		pLine = _read(&szRead);
+		if (!pLine)
+		{
+			_rxOn = _rxStart = false;
+			return false;
+		}
+
+		if (_rxStart)
+		{
+			_rxStart = false;
+			continue;
+		}
+
+		if (bcmp(pLine, _RXR) == 0)
+		{
+			string frame(szRead, '\0');
+			frame.resize(_decodeRX(pLine, szRead, &frame[0], frame.size()));
+			_rxQueue.push_back(frame);
+			continue;
+		}
+
+		if (bcmp(pLine, _RXE) == 0)
+		{
+			continue;
+		}
+
+		break;
+	}
+
+	_rxOn = false;
+	return bcmp(pLine, _OK) == 0;
+}
+
+size_t RN2483::_decodeRX(const char *pLine, size_t szLine, char *pDst, size_t szDst)
+{
+	size_t szHex = szLine - (sizeof(_RXR) - 1);
+	if (szHex / 2 + szHex % 2 > szDst)
+	{
+		return 0;
+	}
+
+	// frames are recorded when they arrive, also those which are queued during other commands
+
+	size_t szFrame = H2D(pLine + sizeof(_RXR) - 1, szHex, pDst, szDst);
+	if (szFrame)
+	{
+		_capture.Write(false, pDst, szFrame);
+	}
+
+	return szFrame;
+}
+
+bool RN2483::_writeCmd(const char *pCmd, const char *pArg)
+{
+	size_t szCmd = strlen(pCmd);
+	size_t szArg = strlen(pArg);
+	if (szCmd + szArg + sizeof(_END) - 1 > _szBuf)
 	{
 		return false;
 	}
 
-	memcpy(pSync, _pRX, szRead - 2);
-	pSync[szRead - 2] = '\0';
+	memcpy(_pTX, pCmd, szCmd);
+	memcpy(_pTX + szCmd, pArg, szArg);
+	memcpy(_pTX + szCmd + szArg, _END, sizeof(_END) - 1);
 
-	return true;
+	return _write(_pTX, szCmd + szArg + sizeof(_END) - 1);
 }
 
-bool RN2483::_write(const char *ptr, size_t sz)
+bool RN2483::_tx(const void *ptr1, size_t sz1, const void *ptr2, size_t sz2)
 {
-	size_t szWrite = write(_fd, ptr, sz);
-	if (szWrite == 0)
+	Clock clk;
+
+	// radio must not receive during TX
+	Trace::Span spanStop("rn2483", "rxstop");
+	bool okStop = _stopRX();
+	spanStop.End();
+	if (!okStop)
+	{
+		return false;
+	}
+
+	// command with translated data (both segments) is written at once
+	size_t szCmd = sizeof(_TXS) - 1;
+	if (szCmd + 2 * (sz1 + sz2) + sizeof(_END) - 1 > _szBuf)
 	{
 		return false;
 	}
-	else if (szWrite != sz)
+
+	Trace::Span spanHex("rn2483", "hex", sz1 + sz2);
+	memcpy(_pTX, _TXS, szCmd);
+	szCmd += D2H(static_cast<const char*>(ptr1), sz1, _pTX + szCmd);
+	szCmd += D2H(static_cast<const char*>(ptr2), sz2, _pTX + szCmd);
+	memcpy(_pTX + szCmd, _END, sizeof(_END) - 1);
+	szCmd += sizeof(_END) - 1;
+	spanHex.End();
+
+	Trace::Span spanWrite("rn2483", "uart write", szCmd);
+	bool okWrite = _write(_pTX, szCmd);
+	spanWrite.End();
+	if (!okWrite)
 	{
 		return false;
 	}
+	// receive ok status
+	Trace::Span spanOk("rn2483", "wait ok");
+	size_t szRead;
+	char *pLine = _read(&szRead);
+	spanOk.End();
+	if (!pLine)
+	{
+		return false;
+	}
+	if (bcmp(pLine, _OK) != 0)
+	{
+		return false;
+	}
+	// TX ends after frame is on air or with watch dog timeout
+	Trace::Span spanAir("rn2483", "wait radio_tx_ok");
+	pLine = _read(&szRead, _wdt / 1000.0 + _toCmd);
+	spanAir.End();
+	if (!pLine)
+	{
+		return false;
+	}
+
+	if (bcmp(pLine, _TXOK) != 0)
+	{
+		return false;
+	}
+
+	_txLatency.Record(clk.Now());
+	_capture.Write(true, ptr1, sz1, ptr2, sz2);
+
+	return true;
+}
+
+bool RN2483::_write(const char *ptr, size_t sz)
+{
+	// non-blocking descriptor may accept only part of data
+	while (sz)
+	{
+		ssize_t szWrite = write(_fd, ptr, sz);
+		if (szWrite < 0)
+		{
+			if (errno != EAGAIN && errno != EINTR)
+			{
+				return false;
+			}
+
+			struct pollfd pfd = { _fd, POLLOUT, 0 };
+			int rc = poll(&pfd, 1, static_cast<int>(_toCmd * 1000.0));
+			if (rc == 0 || (rc < 0 && errno != EINTR))
+			{
+				return false;
+			}
+
+			continue;
+		}
+
+		ptr += szWrite;
+		sz -= szWrite;
+	}
+
 	return true;
 }
 
-size_t RN2483::_read(char *ptr, size_t sz)
+char *RN2483::_read(size_t *pSz)
+{
+	return _read(pSz, _toCmd);
+}
+
+char *RN2483::_read(size_t *pSz, double timeout)
 {
-	return read(_fd, ptr, sz);
+	// lines which are already buffered are returned first, then bytes are read until line is complete
+	Clock clk;
+	while (true)
+	{
+		char *pLine = _lines.Next(pSz);
+		if (pLine)
+		{
+			return pLine;
+		}
+
+		bool okFill = _lines.Fill(_fd);
+		if (!okFill)
+		{
+			return NULL;
+		}
+
+		pLine = _lines.Next(pSz);
+		if (pLine)
+		{
+			return pLine;
+		}
+
+		double left = timeout - clk.Now();
+		if (left <= 0.0)
+		{
+			return NULL;
+		}
+
+		struct pollfd pfd = { _fd, POLLIN, 0 };
+		int rc = poll(&pfd, 1, static_cast<int>(ceil(left * 1000.0)));
+		if (rc == 0 || (rc < 0 && errno != EINTR))
+		{
+			return NULL;
+		}
+
+		if (rc > 0 && !(pfd.revents & POLLIN))
+		{
+			return NULL;
+		}
+	}
 }
@@ -4,11 +4,18 @@
 #include <stdio.h>
 #include <cstring>
 #include <vector>
+#include <deque>
+#include <string>
 #include <errno.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <termios.h>
 
+#include "capture.h"
+#include "clock.h"
+#include "framer.h"
+#include "histogram.h"
 #include "tools.h"
 
 using namespace std;
@@ -69,8 +76,10 @@ namespace RN
 			~RN2483();
 
 			// Initialize RN2483 device and get ready for TX/RX.
+			// pDevice: Pointer to path of serial device (UART of Raspberry or pseudo-terminal of emulator).
+			// warm: Skip reset if device is already configured, only settings which differ are changed.
 			// Returns true on success or false on failure.
-			bool Init();
+			bool Init(const char *pDevice = "/dev/ttyAMA0", bool warm = false);
 
 			// Send data through Comm.
 			// ptr: Pointer to data.
@@ -90,8 +99,26 @@ namespace RN
 			// Receive data through Comm. Data stream is captured until CR LF characters are received.
 			// ptr: Pointer to buffer where received data will be stored as null terminated string without CR LF at the end.
 			// sz: Size of pDst buffer. If size of received data is larger than szDst, data will not be stored at pDst.
-			// Returns number of data successfully read [bytes] or 0 on failure.
-			size_t RX(void *ptr, size_t sz);
+			// timeout: Time to wait for frame [second], reception keeps running after timeout (negative
+			// to wait until reception ends with watch dog timeout).
+			// Returns number of data successfully read [bytes] or 0 on failure or timeout.
+			size_t RX(void *ptr, size_t sz, double timeout = -1.0);
+
+			// Latency of TX commands from start of command to radio_tx_ok (successful commands only).
+			// Returns histogram of latencies.
+			const Histogram &GetTXLatency();
+
+			// Record sent and received frames into pcap-ng file (see Capture).
+			// pFile: Path of capture file or NULL to stop recording.
+			// Returns true on success, false on failure.
+			bool SetCapture(const char *pFile);
+
+			// Keep device receiving between RX calls. Reception is started again right after each
+			// received frame or radio_err (before frame is returned), frames received while other
+			// commands are processed are queued for next RX. Running reception is stopped by TX
+			// and SetWDT (also after continuous reception is disabled).
+			// state: Enable continuous reception.
+			void SetContinuousRX(bool state);
 
 			// Send mac pause command to pause LORAWAN stack.
 			// Returns time [milisecond] on success, 0 on failure.
@@ -207,25 +234,108 @@ namespace RN
 			bool GetSync(char *pSync, size_t szMax);
 
 		private:
+			// Function send frame of one or two data segments by one command and wait until it is on air.
+			// ptr1: Pointer to first segment of TX data.
+			// sz1: Size of first data segment [byte].
+			// ptr2: Pointer to second segment of TX data or NULL.
+			// sz2: Size of second data segment [byte].
+			// Returns true on success of false on failure.
+			bool _tx(const void *ptr1, size_t sz1, const void *ptr2, size_t sz2);
+
 			// Function send data through UART port.
 			// ptr: Pointer to data which will be send.
 			// sz: Size of data which will be send.
 			// Returns true on success, false on failure.
 			bool _write(const char *ptr, size_t sz);
 
-			// Function read data through UART port.
-			// ptr: Pointer to data which will be read.
-			// sz: Size of data which will be read.
-			// Returns size of received data [bytes] or -1 on failure.
-			size_t _read(char *ptr, size_t sz);
+			// Function send command with argument and line ending by one write.
+			// pCmd: Command without line ending.
+			// pArg: Argument of command.
+			// Returns true on success, false on failure.
+			bool _writeCmd(const char *pCmd, const char *pArg);
+
+			// Function read one line through UART port, it waits for response to command at most _toCmd.
+			// pSz: Pointer where size of line without line ending will be stored [bytes].
+			// Returns pointer to null-terminated line (valid until next read) or NULL on failure or timeout.
+			char *_read(size_t *pSz);
+
+			// Function read one line through UART port.
+			// pSz: Pointer where size of line without line ending will be stored [bytes].
+			// timeout: Time to wait for line [second].
+			// Returns pointer to null-terminated line (valid until next read) or NULL on failure or timeout.
+			char *_read(size_t *pSz, double timeout);
+
+			// Add configuration command to queue, it is sent by _flush.
+			// pCmd: Command (with line ending if pArg is NULL).
+			// pArg: Argument of command or NULL.
+			// pRsp: Expected response without line ending or NULL if response is not checked.
+			void _queue(const char *pCmd, const char *pArg, const char *pRsp);
+
+			// Send queued commands without waiting for each response (at most _cmdMax responses are pending)
+			// and compare responses with expected ones in order, failed commands are reported in debug mode.
+			// pRsp: Pointer where all responses will be appended or NULL.
+			// Returns true on success, false if any command failed.
+			bool _flush(vector<string> *pRsp = NULL);
+
+			// Read settings of device and change those which differ from _config (without reset).
+			// Returns true on success, false if device must be reset and configured.
+			bool _warmStart();
+
+			// Start reception on device if it is not running (response is read later).
+			// Returns true on success, false on failure.
+			bool _startRX();
+
+			// Stop reception on device if it is running, frames received before it stopped are queued.
+			// Returns true on success, false on failure.
+			bool _stopRX();
+
+			// Decode received frame from radio_rx line.
+			// pLine: Pointer to line.
+			// szLine: Size of line without line ending [byte].
+			// pDst: Pointer where frame will be stored.
+			// szDst: Size of buffer pDst [byte].
+			// Returns size of frame [byte] or 0 if it does not fit into pDst.
+			size_t _decodeRX(const char *pLine, size_t szLine, char *pDst, size_t szDst);
 
 			static const
 			size_t _szBuf;		// Max size of frame (bytes to be send) [bytes].
 
 			int _fd;		// File descriptor for Comm stream.
+			unsigned int _wdt;	// Watch dog timeout of device [millisecond].
+			static const double _toCmd;	// Timeout for response to command [second].
 
 			char *_pTX;		// Temporary internal TX buffer.
-			char *_pRX;		// Temporary internal RX buffer.
+			Framer _lines;		// Lines received through UART port.
+
+			bool _rxCont;		// Is reception started again after each frame.
+			bool _rxOn;		// Is reception running on device.
+			bool _rxStart;		// Is response to start of reception not read yet.
+			deque<string> _rxQueue;	// Frames received while other commands were processed.
+			Histogram _txLatency;	// Latency of TX commands.
+			Capture _capture;	// Recorded frames.
+
+			// Queued configuration command.
+			struct Cmd
+			{
+				string Line;	// Command with line ending.
+				string Rsp;	// Expected response without line ending.
+				bool Check;	// Is response compared with Rsp.
+			};
+
+			// Radio setting applied by Init.
+			struct Setting
+			{
+				const char *pSet;	// Command which sets value.
+				const char *pArg;	// Argument of pSet or NULL.
+				const char *pGet;	// Command which reads value.
+				const char *pValue;	// Value read by pGet.
+			};
+
+			static const Setting _config[];	// Radio settings applied by Init.
+			static const double _toDrain;	// Time without response after which input is clean [second].
+
+			vector<Cmd> _cmds;	// Commands which are sent by _flush.
+			static const size_t _cmdMax;	// Max number of commands with pending response.
 
 			// Commands used for internal communication with RN2483 device.
 			static const char _DNULL[];
@@ -236,6 +346,7 @@ namespace RN
 			static const char _TXS[];
 			static const char _TXOK[];
 			static const char _RX[];
+			static const char _RXSTOP[];
 			static const char _RXR[];
 			static const char _RXE[];
 			static const char _RESET[];
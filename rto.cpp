@@ -0,0 +1,75 @@
+#include "rto.h"
+#include <cmath>
+
+using namespace RN;
+
+const double RTO::Min = 0.05;
+const double RTO::Max = 60.0;
+
+// Gains of smoothed round-trip time and its variance (RFC 6298).
+static const double _alpha = 1.0 / 8.0;
+static const double _beta = 1.0 / 4.0;
+
+RTO::RTO() :
+	_srtt(0.0),
+	_rttvar(0.0),
+	_rto(1.0),
+	_samples(0)
+{
+}
+
+void RTO::SetInit(double rto)
+{
+	if (!_samples)
+	{
+		_rto = rto < Min ? Min : rto > Max ? Max : rto;
+	}
+}
+
+void RTO::Sample(double rtt)
+{
+	if (!_samples)
+	{
+		_srtt = rtt;
+		_rttvar = rtt / 2.0;
+	}
+	else
+	{
+		_rttvar = (1.0 - _beta) * _rttvar + _beta * fabs(_srtt - rtt);
+		_srtt = (1.0 - _alpha) * _srtt + _alpha * rtt;
+	}
+
+	_samples++;
+
+	// variance term must not be smaller than granularity of timeout
+
+	double var = 4.0 * _rttvar;
+	_rto = _srtt + (var > Min ? var : Min);
+	_rto = _rto < Min ? Min : _rto > Max ? Max : _rto;
+}
+
+void RTO::Backoff()
+{
+	_rto = 2.0 * _rto > Max ? Max : 2.0 * _rto;
+}
+
+double RTO::Get() { return _rto; }
+
+double RTO::GetBudget(unsigned char retry)
+{
+	double budget = 0.0;
+	double rto = _rto;
+	for (unsigned int i = 0; i <= retry; i++)
+	{
+		budget += rto;
+		rto = 2.0 * rto > Max ? Max : 2.0 * rto;
+	}
+
+	return budget;
+}
+
+double RTO::GetSRTT() { return _srtt; }
+
+double RTO::GetRTTVar() { return _rttvar; }
+
+size_t RTO::GetSamples() { return _samples; }
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+
+namespace RN
+{
+	// Retransmission timeout estimated from measured round-trip time (smoothed RTT and its
+	// variance as in RFC 6298). Only packets sent once are measured (Karn's rule), timeout is
+	// doubled after each expiry until next measurement.
+	class RTO
+	{
+		public:
+			// Default class constructor (initial timeout 1 second).
+			RTO();
+
+			// Set timeout used until round-trip time is measured.
+			// rto: Initial timeout [second].
+			void SetInit(double rto);
+
+			// Add measured round-trip time of packet which is not retransmitted.
+			// rtt: Time from end of TX to received response [second].
+			void Sample(double rtt);
+
+			// Double timeout after it expired without response.
+			void Backoff();
+
+			// Current retransmission timeout [second].
+			double Get();
+
+			// Sum of timeouts of all attempts to send packet with backoff.
+			// retry: Number of retries after first attempt.
+			// Returns time which sending node can wait for responses before error is raised [second].
+			double GetBudget(unsigned char retry);
+
+			// Smoothed round-trip time [second] (0 if not measured yet).
+			double GetSRTT();
+
+			// Variance of round-trip time [second].
+			double GetRTTVar();
+
+			// Number of measured round-trip times.
+			size_t GetSamples();
+
+			static const double Min;	// Min timeout [second].
+			static const double Max;	// Max timeout [second].
+
+		private:
+			double _srtt;		// Smoothed round-trip time [second].
+			double _rttvar;		// Variance of round-trip time [second].
+			double _rto;		// Current timeout (with backoff) [second].
+			size_t _samples;	// Number of measured round-trip times.
+	};
+};
@@ -0,0 +1,471 @@
+#include <boost/program_options.hpp>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <signal.h>
+#include <sys/wait.h>
+
+#include "comm.h"
+#include "clock.h"
+#include "trace.h"
+#include "log.h"
+
+#define WHITE "\033[0m"
+#define RED "\033[1;31m"
+#define GREEN "\033[1;32m"
+#define BROWN "\033[1;33m"
+
+using namespace std;
+using namespace RN;
+namespace po = boost::program_options;
+
+// Parameters of one measured point of sweep.
+struct Point
+{
+	unsigned int Size;		// Size of message [byte].
+	bool Ack;			// Messages are acknowledged.
+	string Crypt;			// Encryption (none, pub, pvt or sym).
+	unsigned int BitRate;		// Bit rate of radio [bit/second].
+	double Loss;			// Probability of frame loss in emulator.
+};
+
+// Measured results of one point.
+struct Result
+{
+	size_t Sent;			// Number of messages which Send reported as sent.
+	size_t Delivered;		// Number of messages received by receiving node.
+	double Time;			// Time from first send to last delivery (0 if nothing is delivered) [second].
+	double Goodput;			// Delivered message data per second [byte/second].
+	double P50;			// Median message latency [second].
+	double P99;			// 99th percentile of message latency [second].
+	size_t Retransmit;		// Number of data packets sent again.
+	double Ceiling;			// Goodput limited only by air time of frames [byte/second].
+};
+
+void parse_args(int argc, char **argv, po::options_description &optDesc, po::variables_map &varMap);
+pid_t start_emulator(const po::variables_map &vm, double loss, int *pFd);
+void stop_emulator(pid_t pid, int fd);
+bool init_comm(Comm *pComm, const po::variables_map &vm, const Point &point, const char *pDevice, bool tx);
+bool run_point(const po::variables_map &vm, const Point &point, Result *pResult);
+double percentile(vector<double> &values, double p);
+
+int main(int argc, char **argv)
+{
+	po::options_description desc;
+	po::variables_map vm;
+	parse_args(argc, argv, desc, vm);
+
+	if (vm.count("help"))
+	{
+		cout << desc << "\n";
+		return 0;
+	}
+
+	const vector<double> &losses = vm["loss"].as<vector<double>>();
+	if (!vm.count("emulator") && (losses.size() != 1 || losses[0] != 0.0))
+	{
+		cout << RED "[ERROR]" WHITE " Loss can be swept only with emulator\n";
+		return -1;
+	}
+
+	for (const string &crypt : vm["crypt"].as<vector<string>>())
+	{
+		if (crypt != "none" && crypt != "pub" && crypt != "pvt" && crypt != "sym")
+		{
+			cout << RED "[ERROR]" WHITE " Invalid encryption " << crypt << "\n";
+			return -1;
+		}
+
+		if (crypt != "none" && !(vm.count("publickey") && vm.count("privatekey")))
+		{
+			cout << RED "[ERROR]" WHITE " Encryption requires public and private key\n";
+			return -1;
+		}
+	}
+
+	ofstream ofs(vm["output"].as<string>().data(), fstream::out | fstream::trunc);
+	if (!ofs)
+	{
+		cout << RED "[ERROR]" WHITE " Unable to open output file\n";
+		return -1;
+	}
+
+	// messages of both nodes are printed by background thread
+
+	Log::Start();
+
+	// both nodes record into one trace, each on its own thread
+
+	if (vm.count("trace") && !Trace::Enable(1 << 20))
+	{
+		cout << RED "[ERROR]" WHITE " Unable to enable trace\n";
+		return -1;
+	}
+
+	ofs << "size,ack,crypt,bitrate,loss,messages,sent,delivered,time,goodput,p50,p99,retransmit,ceiling,efficiency\n";
+
+	// each point runs on freshly started emulator so points do not influence each other
+
+	Point point;
+	size_t incomplete = 0;
+	for (unsigned int rate : vm["bitrate"].as<vector<unsigned int>>())
+	for (double loss : losses)
+	for (const string &crypt : vm["crypt"].as<vector<string>>())
+	for (int ack : vm["ack"].as<vector<int>>())
+	for (unsigned int size : vm["size"].as<vector<unsigned int>>())
+	{
+		point.Size = size;
+		point.Ack = ack;
+		point.Crypt = crypt;
+		point.BitRate = rate;
+		point.Loss = loss;
+
+		int fd = -1;
+		pid_t pid = 0;
+		if (vm.count("emulator"))
+		{
+			pid = start_emulator(vm, loss, &fd);
+			if (pid <= 0)
+			{
+				cout << RED "[ERROR]" WHITE " Unable to start emulator\n";
+				return -1;
+			}
+		}
+
+		Result result;
+		bool okRun = run_point(vm, point, &result);
+
+		if (pid > 0)
+		{
+			stop_emulator(pid, fd);
+		}
+
+		if (!okRun)
+		{
+			LOG_WARNING("SWEEP size(%u), ack(%i), crypt(%s), bitrate(%u), loss(%f) skipped",
+				size, ack, crypt.data(), rate, loss);
+			continue;
+		}
+
+		// efficiency is measured goodput in percent of air time ceiling
+
+		char line[256];
+		snprintf(line, sizeof(line), "%u,%i,%s,%u,%f,%u,%zu,%zu,%f,%f,%f,%f,%zu,%f,%f",
+			size, ack, crypt.data(), rate, loss, vm["messages"].as<unsigned int>(),
+			result.Sent, result.Delivered, result.Time, result.Goodput, result.P50, result.P99, result.Retransmit,
+			result.Ceiling, result.Ceiling > 0.0 ? 100.0 * result.Goodput / result.Ceiling : 0.0);
+
+		ofs << line << "\n";
+		ofs.flush();
+
+		// message may be lost only if it is not acknowledged on lossy channel
+
+		if (result.Delivered < result.Sent)
+		{
+			bool expected = !ack && loss > 0.0;
+			incomplete += !expected;
+			LOG_RECOVERABLE(expected, "SWEEP %s delivered(%zu/%zu)", line, result.Delivered, result.Sent);
+		}
+		else
+		{
+			LOG_OK("SWEEP %s", line);
+		}
+	}
+
+	Log::Stop();
+
+	if (vm.count("trace") && !Trace::Dump(vm["trace"].as<string>().data()))
+	{
+		cout << RED "[ERROR]" WHITE " Unable to write trace\n";
+		return -1;
+	}
+
+	if (incomplete)
+	{
+		cout << RED "[ERROR]" WHITE " Messages were lost in " << incomplete << " points\n";
+		return 1;
+	}
+
+	return 0;
+}
+
+pid_t start_emulator(const po::variables_map &vm, double loss, int *pFd)
+{
+	int fds[2];
+	if (pipe(fds) != 0)
+	{
+		return -1;
+	}
+
+	char szLoss[32];
+	char szSeed[32];
+	snprintf(szLoss, sizeof(szLoss), "%f", loss);
+	snprintf(szSeed, sizeof(szSeed), "%u", vm["seed"].as<unsigned int>());
+
+	string path = vm["emulator"].as<string>();
+	string dev0 = vm["dev0"].as<string>();
+	string dev1 = vm["dev1"].as<string>();
+
+	pid_t pid = fork();
+	if (pid == 0)
+	{
+		dup2(fds[1], STDOUT_FILENO);
+		close(fds[0]);
+		close(fds[1]);
+		execl(path.data(), path.data(), "--dev0", dev0.data(), "--dev1", dev1.data(),
+			"--loss", szLoss, "--seed", szSeed, static_cast<char*>(NULL));
+		_exit(127);
+	}
+
+	close(fds[1]);
+	if (pid < 0)
+	{
+		close(fds[0]);
+		return -1;
+	}
+
+	// emulator prints both links when its devices are ready
+
+	unsigned int lines = 0;
+	char c;
+	while (lines < 2 && read(fds[0], &c, 1) == 1)
+	{
+		lines += c == '\n';
+	}
+
+	if (lines < 2)
+	{
+		stop_emulator(pid, fds[0]);
+		return -1;
+	}
+
+	*pFd = fds[0];
+	return pid;
+}
+
+void stop_emulator(pid_t pid, int fd)
+{
+	kill(pid, SIGTERM);
+	waitpid(pid, NULL, 0);
+	close(fd);
+}
+
+bool init_comm(Comm *pComm, const po::variables_map &vm, const Point &point, const char *pDevice, bool tx)
+{
+	bool okInit = pComm->Init(pDevice, true);
+	if (!okInit)
+	{
+		return false;
+	}
+
+	PacketInfo info;
+	info.LocalId = tx ? 21 : 20;
+	info.RemoteId = tx ? 20 : 21;
+	info.Port = 10;
+	pComm->SetInfo(&info);
+
+	bool okConfig =
+		pComm->SetBitRate(point.BitRate) &&
+		pComm->SetFEC(static_cast<unsigned char>(vm["fec"].as<int>())) &&
+		pComm->SetRetry(static_cast<unsigned char>(vm["retry"].as<int>())) &&
+		pComm->SetWindow(static_cast<unsigned char>(vm["window"].as<int>()));
+	if (!okConfig)
+	{
+		return false;
+	}
+
+	if (point.Crypt != "none")
+	{
+		bool okCrypt = pComm->SetCrypt(
+			vm["publickey"].as<string>().data(),
+			vm["privatekey"].as<string>().data());
+		if (!okCrypt)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool run_point(const po::variables_map &vm, const Point &point, Result *pResult)
+{
+	Comm tx;
+	Comm rx;
+
+	bool okInit =
+		init_comm(&rx, vm, point, vm["dev0"].as<string>().data(), false) &&
+		init_comm(&tx, vm, point, vm["dev1"].as<string>().data(), true);
+	if (!okInit)
+	{
+		return false;
+	}
+
+	size_t szBuf = point.Crypt == "sym" ? tx.GetSzSymBuf() : point.Crypt != "none" ? tx.GetSzDecryptBuf() : tx.GetMaxSz();
+	if (point.Size < sizeof(unsigned int) || point.Size > szBuf)
+	{
+		return false;
+	}
+
+	unsigned int messages = vm["messages"].as<unsigned int>();
+	vector<double> start(messages, -1.0);
+	vector<double> done(messages, -1.0);
+	atomic<bool> sendEnd(false);
+
+	Clock clk;
+
+	// receiving node runs in own thread, message carries its index so latency is measured from start of its send
+
+	thread receiver([&]()
+	{
+		vector<char> buf(szBuf);
+		size_t delivered = 0;
+		while (delivered < messages)
+		{
+			size_t szRX = 0;
+			bool okRX;
+			if (point.Crypt == "pub")
+			{
+				okRX = rx.ReceiveDecryptPvt(&buf[0], buf.size(), &szRX);
+			}
+			else if (point.Crypt == "pvt")
+			{
+				okRX = rx.ReceiveDecryptPub(&buf[0], buf.size(), &szRX);
+			}
+			else if (point.Crypt == "sym")
+			{
+				okRX = rx.ReceiveDecryptSym(&buf[0], buf.size(), &szRX);
+			}
+			else
+			{
+				okRX = rx.Receive(&buf[0], buf.size(), &szRX);
+			}
+
+			if (!okRX || szRX < sizeof(unsigned int))
+			{
+				if (sendEnd)
+				{
+					break;
+				}
+				continue;
+			}
+
+			unsigned int idx;
+			memcpy(&idx, &buf[0], sizeof(idx));
+			if (idx < messages && done[idx] < 0.0)
+			{
+				done[idx] = clk.Now();
+				delivered++;
+			}
+		}
+
+		if (point.Ack)
+		{
+			rx.Linger();
+		}
+	});
+
+	vector<char> msg(point.Size);
+	for (size_t i = 0; i < msg.size(); i++)
+	{
+		msg[i] = static_cast<char>(i * 151 + 7);
+	}
+
+	size_t sent = 0;
+	size_t retransmit = tx.GetRetransmit();
+	for (unsigned int i = 0; i < messages; i++)
+	{
+		memcpy(&msg[0], &i, sizeof(i));
+		start[i] = clk.Now();
+
+		bool okSend;
+		if (point.Crypt == "pub")
+		{
+			okSend = tx.EncryptPubSend(&msg[0], msg.size(), point.Ack);
+		}
+		else if (point.Crypt == "pvt")
+		{
+			okSend = tx.EncryptPvtSend(&msg[0], msg.size(), point.Ack);
+		}
+		else if (point.Crypt == "sym")
+		{
+			okSend = tx.EncryptSymSend(&msg[0], msg.size(), point.Ack);
+		}
+		else
+		{
+			okSend = tx.Send(&msg[0], msg.size(), point.Ack);
+		}
+
+		sent += okSend;
+	}
+
+	sendEnd = true;
+	receiver.join();
+
+	// latencies and goodput of delivered messages only
+
+	vector<double> latency;
+	double end = 0.0;
+	for (unsigned int i = 0; i < messages; i++)
+	{
+		if (done[i] >= 0.0)
+		{
+			latency.push_back(done[i] - start[i]);
+			end = max(end, done[i]);
+		}
+	}
+
+	pResult->Sent = sent;
+	pResult->Delivered = latency.size();
+	pResult->Time = latency.empty() ? 0.0 : end - start[0];
+	pResult->Goodput = pResult->Time > 0.0 ? latency.size() * point.Size / pResult->Time : 0.0;
+	pResult->P50 = percentile(latency, 0.50);
+	pResult->P99 = percentile(latency, 0.99);
+	pResult->Retransmit = tx.GetRetransmit() - retransmit;
+	pResult->Ceiling = tx.GetGoodputMax(point.Size, point.Ack);
+
+	return true;
+}
+
+double percentile(vector<double> &values, double p)
+{
+	if (values.empty())
+	{
+		return 0.0;
+	}
+
+	// nearest rank
+	sort(values.begin(), values.end());
+	size_t rank = static_cast<size_t>(ceil(p * values.size()));
+	return values[rank ? rank - 1 : 0];
+}
+
+void parse_args(int argc, char **argv, po::options_description &optDesc, po::variables_map &varMap)
+{
+	optDesc.add_options()
+		("help,h", "Help screen")
+		("emulator", po::value<string>(), "Path of emulator which is started for each point (real devices are used without it)")
+		("dev0", po::value<string>()->default_value("/tmp/rn2483-0"), "Serial device of receiving node")
+		("dev1", po::value<string>()->default_value("/tmp/rn2483-1"), "Serial device of sending node")
+		("output,o", po::value<string>()->default_value("sweep.csv"), "Output file with results (CSV)")
+		("messages,n", po::value<unsigned int>()->default_value(10), "Number of messages in each point")
+		("size", po::value<vector<unsigned int>>()->multitoken()->default_value(vector<unsigned int>{16, 64, 256, 1024}, "16 64 256 1024"), "Sizes of message [byte]")
+		("ack", po::value<vector<int>>()->multitoken()->default_value(vector<int>{1, 0}, "1 0"), "Acknowledge modes (1 with ack, 0 without)")
+		("crypt", po::value<vector<string>>()->multitoken()->default_value(vector<string>{"none"}, "none"), "Encryption modes (none, pub, pvt, sym)")
+		("bitrate", po::value<vector<unsigned int>>()->multitoken()->default_value(vector<unsigned int>{2500}, "2500"), "Bit rates of radio [bit/second]")
+		("loss", po::value<vector<double>>()->multitoken()->default_value(vector<double>{0.0}, "0"), "Probabilities of frame loss (emulator only)")
+		("seed", po::value<unsigned int>()->default_value(1), "Seed of emulated channel")
+		("publickey,k", po::value<string>(), "Public key to use with RSA encryption")
+		("privatekey,i", po::value<string>(), "Private key to use with RSA encryption")
+		("fec", po::value<int>()->default_value(0), "Number of Reed-Solomon parity bytes in each packet")
+		("window,w", po::value<int>()->default_value(8), "Number of packets sent before waiting for acknowledge")
+		("retry", po::value<int>()->default_value(4), "Number of retries of packet with doubled timeout")
+		("trace", po::value<string>(), "Record phases of both nodes and write them as Chrome trace JSON into this file");
+
+	po::store(po::parse_command_line(argc, argv, optDesc), varMap);
+	po::notify(varMap);
+};
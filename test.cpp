@@ -16,10 +16,23 @@ int main()
 		txt[idx] = idx + 1;
 	}
 
-	RN2483 rn;
-	rn.Init();
+	// cold start resets device, warm start only reads its settings back
 
 	Clock clk;
+	{
+		RN2483 cold;
+		cold.Init();
+	}
+	double cold = clk.Now();
+
+	clk.Reset();
+	RN2483 rn;
+	rn.Init("/dev/ttyAMA0", true);
+	double warm = clk.Now();
+
+	printf("Init cold %f seconds, warm %f seconds\n", cold, warm);
+
+	clk.Reset();
 
 	for (unsigned int i = 0; i < ITER; i++)
 	{
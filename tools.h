@@ -3,6 +3,12 @@
 #include <cstdio>
 #include <cstring>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 namespace RN
 {
 	// Lookup table for dec to hex conversion.
@@ -27,7 +33,7 @@ namespace RN
 	};
 
 	// Lookup table for hex to dec conversion.
-	const char LT_H2D[] =
+	const unsigned char LT_H2D[] =
 	{
 		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
 		0, 1, 2, 3, 4, 5, 6, 7, 8, 9,
@@ -38,23 +44,120 @@ namespace RN
 		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
 	};
 
-	// Translate decimal data into hex data and store it.
+	// Translate decimal data into hex data without vector instructions.
 	// pIn: Pointer to input buffer which will be translated.
 	// szIn: Size of data which needs to be translated [bytes].
 	// pOut: Pointer to output buffer where that will be stored.
 	// Returns size of translated data [bytes].
-	inline size_t D2H(const char *pIn, size_t szIn, char *pOut)
+	inline size_t D2HScalar(const char *pIn, size_t szIn, char *pOut)
 	{
-		short *ptr = reinterpret_cast<short*>(pOut);
+		const unsigned char *pSrc = reinterpret_cast<const unsigned char*>(pIn);
 		for (size_t i = 0; i < szIn; i++)
 		{
-			ptr[i] = LT_D2H[pIn[i]];
+			memcpy(pOut + 2 * i, &LT_D2H[pSrc[i]], 2);
 		}
 
 		return szIn * 2;
 	};
 
-	// Translate hex data into decimal data and store it inside _pBuf.
+	// Translate hex data into decimal data without vector instructions, last digit of odd
+	// sized input is upper half of last byte.
+	// pIn: Pointer to input buffer which will be translated.
+	// szIn: Size of data which needs to be translated [bytes].
+	// pOut: Pointer to output buffer where translated data will be stored.
+	// szOut: Size of buffer where translated data will be stored [bytes].
+	// Returns size of translated data [bytes].
+	inline size_t H2DScalar(const char *pIn, size_t szIn, char *pOut, size_t szOut)
+	{
+		const unsigned char *pSrc = reinterpret_cast<const unsigned char*>(pIn);
+		size_t sz = szIn / 2 + szIn % 2;
+		sz = sz < szOut ? sz : szOut;
+
+		size_t i = 0;
+		for (; i < sz && 2 * i + 1 < szIn; i++)
+		{
+			pOut[i] = LT_H2D[pSrc[2 * i]] << 4 | LT_H2D[pSrc[2 * i + 1]];
+		}
+
+		if (i < sz)
+		{
+			pOut[i] = LT_H2D[pSrc[2 * i]] << 4;
+		}
+
+		return sz;
+	};
+
+#if defined(__SSE2__)
+	// Value of hex digits in vector (0 for other characters).
+	inline __m128i _hexValue(__m128i v)
+	{
+		__m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+		__m128i digit = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8('9' + 1)));
+		__m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(lower, _mm_set1_epi8('f' + 1)));
+
+		return _mm_or_si128(
+			_mm_and_si128(digit, _mm_sub_epi8(v, _mm_set1_epi8('0'))),
+			_mm_and_si128(alpha, _mm_sub_epi8(lower, _mm_set1_epi8('a' - 10))));
+	};
+#elif defined(__ARM_NEON)
+	// Value of hex digits in vector (0 for other characters).
+	inline uint8x16_t _hexValue(uint8x16_t v)
+	{
+		uint8x16_t digit = vsubq_u8(v, vdupq_n_u8('0'));
+		uint8x16_t alpha = vsubq_u8(vorrq_u8(v, vdupq_n_u8(0x20)), vdupq_n_u8('a'));
+
+		return vorrq_u8(
+			vandq_u8(vcltq_u8(digit, vdupq_n_u8(10)), digit),
+			vandq_u8(vcltq_u8(alpha, vdupq_n_u8(6)), vaddq_u8(alpha, vdupq_n_u8(10))));
+	};
+#endif
+
+	// Translate decimal data into hex data and store it (16 bytes at once with SSE2 or NEON).
+	// pIn: Pointer to input buffer which will be translated.
+	// szIn: Size of data which needs to be translated [bytes].
+	// pOut: Pointer to output buffer where that will be stored.
+	// Returns size of translated data [bytes].
+	inline size_t D2H(const char *pIn, size_t szIn, char *pOut)
+	{
+		size_t i = 0;
+#if defined(__SSE2__)
+		const __m128i mask = _mm_set1_epi8(0x0F);
+		for (; i + 16 <= szIn; i += 16)
+		{
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pIn + i));
+			__m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), mask);
+			__m128i lo = _mm_and_si128(v, mask);
+
+			// digits above 9 are shifted from ':' to 'A'
+			hi = _mm_add_epi8(_mm_add_epi8(hi, _mm_set1_epi8('0')), _mm_and_si128(_mm_cmpgt_epi8(hi, _mm_set1_epi8(9)), _mm_set1_epi8(7)));
+			lo = _mm_add_epi8(_mm_add_epi8(lo, _mm_set1_epi8('0')), _mm_and_si128(_mm_cmpgt_epi8(lo, _mm_set1_epi8(9)), _mm_set1_epi8(7)));
+
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(pOut + 2 * i), _mm_unpacklo_epi8(hi, lo));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(pOut + 2 * i + 16), _mm_unpackhi_epi8(hi, lo));
+		}
+#elif defined(__ARM_NEON)
+		for (; i + 16 <= szIn; i += 16)
+		{
+			uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t*>(pIn + i));
+			uint8x16x2_t hex;
+			hex.val[0] = vshrq_n_u8(v, 4);
+			hex.val[1] = vandq_u8(v, vdupq_n_u8(0x0F));
+
+			// digits above 9 are shifted from ':' to 'A'
+			for (int j = 0; j < 2; j++)
+			{
+				uint8x16_t gap = vandq_u8(vcgtq_u8(hex.val[j], vdupq_n_u8(9)), vdupq_n_u8(7));
+				hex.val[j] = vaddq_u8(vaddq_u8(hex.val[j], vdupq_n_u8('0')), gap);
+			}
+
+			vst2q_u8(reinterpret_cast<uint8_t*>(pOut + 2 * i), hex);
+		}
+#endif
+		return 2 * i + D2HScalar(pIn + i, szIn - i, pOut + 2 * i);
+	};
+
+	// Translate hex data into decimal data and store it (16 bytes at once with SSE2 or NEON), last
+	// digit of odd sized input is upper half of last byte.
 	// pIn: Pointer to input buffer which will be translated.
 	// szIn: Size of data which needs to be translated [bytes].
 	// pOut: Pointer to output buffer where translated data will be stored.
@@ -62,12 +165,30 @@ namespace RN
 	// Returns size of translated data [bytes].
 	inline size_t H2D(const char *pIn, size_t szIn, char *pOut, size_t szOut)
 	{
-		for (size_t i = 0; i < szIn; i += 2)
+		size_t i = 0;
+#if defined(__SSE2__)
+		const __m128i mask = _mm_set1_epi16(0x00FF);
+		for (; 2 * i + 32 <= szIn && i + 16 <= szOut; i += 16)
 		{
-			pOut[i / 2] = LT_H2D[pIn[i]] << 4 | LT_H2D[pIn[i + 1]];
+			__m128i v0 = _hexValue(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pIn + 2 * i)));
+			__m128i v1 = _hexValue(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pIn + 2 * i + 16)));
+
+			// upper digit is in low byte of each 16-bit lane
+			v0 = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(v0, mask), 4), _mm_srli_epi16(v0, 8));
+			v1 = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(v1, mask), 4), _mm_srli_epi16(v1, 8));
+
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(pOut + i), _mm_packus_epi16(v0, v1));
 		}
+#elif defined(__ARM_NEON)
+		for (; 2 * i + 32 <= szIn && i + 16 <= szOut; i += 16)
+		{
+			uint8x16x2_t hex = vld2q_u8(reinterpret_cast<const uint8_t*>(pIn + 2 * i));
+			uint8x16_t v = vorrq_u8(vshlq_n_u8(_hexValue(hex.val[0]), 4), _hexValue(hex.val[1]));
 
-		return szIn / 2 + szIn % 2;
+			vst1q_u8(reinterpret_cast<uint8_t*>(pOut + i), v);
+		}
+#endif
+		return i + H2DScalar(pIn + 2 * i, szIn - 2 * i, pOut + i, szOut - i);
 	};
 
 	// Compare if two null-terminated strings are equal.
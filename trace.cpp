@@ -0,0 +1,146 @@
+#include "trace.h"
+#include <cstdio>
+#include <chrono>
+#include <new>
+
+using namespace std;
+using namespace std::chrono;
+using namespace RN;
+
+Trace::Event *Trace::_pEvents = NULL;
+size_t Trace::_szEvents = 0;
+atomic<size_t> Trace::_next(0);
+atomic<unsigned int> Trace::_threads(0);
+uint64_t Trace::_tStart = 0;
+bool Trace::_on = false;
+
+Trace::Span::Span(const char *pCat, const char *pName, unsigned int arg) :
+	_pCat(pCat),
+	_pName(pName),
+	_arg(arg),
+	_tBegin(0),
+	_on(Trace::_on)
+{
+	if (_on)
+	{
+		_tBegin = Trace::Now();
+	}
+}
+
+Trace::Span::~Span()
+{
+	End();
+}
+
+void Trace::Span::End()
+{
+	if (_on)
+	{
+		_on = false;
+		Trace::Record(_pCat, _pName, _arg, _tBegin, Trace::Now());
+	}
+}
+
+bool Trace::Enable(size_t szEvents)
+{
+	if (!szEvents)
+	{
+		return false;
+	}
+
+	Disable();
+
+	_pEvents = new (nothrow) Event[szEvents];
+	if (!_pEvents)
+	{
+		return false;
+	}
+
+	_szEvents = szEvents;
+	_next = 0;
+	_tStart = 0;
+	_tStart = Now();
+	_on = true;
+
+	return true;
+}
+
+void Trace::Disable()
+{
+	_on = false;
+
+	delete[] _pEvents;
+	_pEvents = NULL;
+	_szEvents = 0;
+}
+
+bool Trace::IsEnabled()
+{
+	return _on;
+}
+
+void Trace::Record(const char *pCat, const char *pName, unsigned int arg, uint64_t tBegin, uint64_t tEnd)
+{
+	if (!_on)
+	{
+		return;
+	}
+
+	// slot is reserved atomically so spans of both nodes in one process do not collide
+
+	Event &event = _pEvents[_next.fetch_add(1, memory_order_relaxed) % _szEvents];
+	event.pCat = pCat;
+	event.pName = pName;
+	event.Arg = arg;
+	event.Thread = _thread();
+	event.Begin = tBegin;
+	event.Duration = tEnd - tBegin;
+}
+
+bool Trace::Dump(const char *pFile)
+{
+	if (!_pEvents)
+	{
+		return false;
+	}
+
+	FILE *pOut = fopen(pFile, "w");
+	if (!pOut)
+	{
+		return false;
+	}
+
+	// oldest spans are overwritten when ring is full
+
+	size_t next = _next.load();
+	size_t count = next < _szEvents ? next : _szEvents;
+
+	fprintf(pOut, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+	for (size_t i = next - count; i < next; i++)
+	{
+		const Event &event = _pEvents[i % _szEvents];
+		fprintf(pOut, "{\"cat\":\"%s\",\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"arg\":%u}}%s\n",
+			event.pCat, event.pName, event.Thread, event.Begin / 1000.0, event.Duration / 1000.0, event.Arg,
+			i + 1 < next ? "," : "");
+	}
+	fprintf(pOut, "]}\n");
+
+	bool okWrite = !ferror(pOut);
+	return fclose(pOut) == 0 && okWrite;
+}
+
+uint64_t Trace::Now()
+{
+	return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count() - _tStart;
+}
+
+unsigned int Trace::_thread()
+{
+	static thread_local unsigned int thread = 0;
+	if (!thread)
+	{
+		thread = ++_threads;
+	}
+
+	return thread;
+}
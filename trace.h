@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+
+namespace RN
+{
+	// Tracing of hot path phases (hex translation, UART writes, waiting for responses, air time, ack waits).
+	// Spans are stored with monotonic timestamps into preallocated ring buffer, oldest spans are overwritten
+	// when buffer is full. Buffer is dumped as Chrome trace JSON (chrome://tracing or Perfetto). Tracing is
+	// off until Enable is called, disabled span costs only one branch.
+	class Trace
+	{
+		public:
+			// Span of one phase from its construction to End or destruction (whichever comes first).
+			class Span
+			{
+				public:
+					// Start span.
+					// pCat: Category (string literal, e.g. "rn2483").
+					// pName: Name of phase (string literal).
+					// arg: Value shown with span (e.g. segment id or size).
+					Span(const char *pCat, const char *pName, unsigned int arg = 0);
+
+					// End span if it has not ended yet.
+					~Span();
+
+					// End span before its destruction.
+					void End();
+
+				private:
+					const char *_pCat;
+					const char *_pName;
+					unsigned int _arg;
+					uint64_t _tBegin;
+					bool _on;
+			};
+
+			// Allocate ring buffer and start tracing.
+			// szEvents: Maximum number of stored spans.
+			// Returns true on success, false on failure.
+			static bool Enable(size_t szEvents);
+
+			// Stop tracing and release ring buffer.
+			static void Disable();
+
+			// Check if tracing is on.
+			// Returns true if tracing is on.
+			static bool IsEnabled();
+
+			// Store span into ring buffer.
+			// pCat: Category (string literal).
+			// pName: Name of phase (string literal).
+			// arg: Value shown with span.
+			// tBegin: Start of span [nanosecond].
+			// tEnd: End of span [nanosecond].
+			static void Record(const char *pCat, const char *pName, unsigned int arg, uint64_t tBegin, uint64_t tEnd);
+
+			// Write stored spans as Chrome trace JSON, spans should not be recorded meanwhile.
+			// pFile: Output file name.
+			// Returns true on success, false on failure.
+			static bool Dump(const char *pFile);
+
+			// Monotonic time since tracing has been enabled.
+			// Returns time [nanosecond].
+			static uint64_t Now();
+
+		private:
+			// Stored span.
+			struct Event
+			{
+				const char *pCat;
+				const char *pName;
+				unsigned int Arg;
+				unsigned int Thread;
+				uint64_t Begin;
+				uint64_t Duration;
+			};
+
+			// Small number identifying calling thread in trace.
+			// Returns thread number.
+			static unsigned int _thread();
+
+			static Event *_pEvents;			// Ring buffer.
+			static size_t _szEvents;		// Size of ring buffer [span].
+			static std::atomic<size_t> _next;	// Number of spans recorded since enable.
+			static std::atomic<unsigned int> _threads;	// Number of threads which recorded span.
+			static uint64_t _tStart;		// Time of enable [nanosecond].
+			static bool _on;			// Tracing is on.
+	};
+};
@@ -62,53 +62,12 @@ bool UART::Init()
 
 bool UART::TX(const void *ptr, size_t sz)
 {
-	// translate data
-	size_t szHex = D2H(static_cast<const char*>(ptr), sz, reinterpret_cast<char*>(_pTX));
-
-	// transmit data
-	bool okWrite = _write(_pTX, szHex);
-	if (!okWrite)
-	{
-		return false;
-	}
-
-	const unsigned char end[] = "\n";
-	okWrite = _write(end, sizeof(end) - 1);
-	if (!okWrite)
-	{
-		return false;
-	}
-
-	return true;
+	return _tx(ptr, sz, NULL, 0);
 }
 
 bool UART::TX(const void *ptr1, size_t sz1, const void *ptr2, size_t sz2)
 {
-	// translate and send first data segment
-	size_t szHex = D2H(static_cast<const char*>(ptr1), sz1, reinterpret_cast<char*>(_pTX));
-
-	bool okWrite = _write(_pTX, szHex);
-	if (!okWrite)
-	{
-		return false;
-	}
-
-	// translate and send second data segment
-	szHex = D2H(static_cast<const char*>(ptr2), sz2, reinterpret_cast<char*>(_pTX));
-	okWrite = _write(_pTX, szHex);
-	if (!okWrite)
-	{
-		return false;
-	}
-
-	const unsigned char end[] = "\n";
-	okWrite = _write(end, sizeof(end) - 1);
-	if (!okWrite)
-	{
-		return false;
-	}
-
-	return true;
+	return _tx(ptr1, sz1, ptr2, sz2);
 }
 
 size_t UART::RX(void *pDst, size_t szDst)
@@ -126,6 +85,29 @@ size_t UART::RX(void *pDst, size_t szDst)
 	return szHex;
 }
 
+bool UART::_tx(const void *ptr1, size_t sz1, const void *ptr2, size_t sz2)
+{
+	// translated data (both segments) and line end are written at once
+	if (2 * (sz1 + sz2) > _szBuf)
+	{
+		return false;
+	}
+
+	char *pHex = reinterpret_cast<char*>(_pTX);
+	size_t szHex = D2H(static_cast<const char*>(ptr1), sz1, pHex);
+	szHex += D2H(static_cast<const char*>(ptr2), sz2, pHex + szHex);
+	pHex[szHex++] = '\n';
+
+	// transmit data
+	bool okWrite = _write(_pTX, szHex);
+	if (!okWrite)
+	{
+		return false;
+	}
+
+	return true;
+}
+
 bool UART::_write(const unsigned char *ptr, size_t sz)
 {
 	size_t szWrite = write(_fd, ptr, sz);
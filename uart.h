@@ -52,6 +52,14 @@ namespace RN
 			size_t RX(void *ptr, size_t sz);
 
 		private:
+			// Function send translated data of one or two segments through UART port by one write.
+			// ptr1: Pointer to first segment of TX data.
+			// sz1: Size of first data segment [byte].
+			// ptr2: Pointer to second segment of TX data or NULL.
+			// sz2: Size of second data segment [byte].
+			// Returns true on success of false on failure.
+			bool _tx(const void *ptr1, size_t sz1, const void *ptr2, size_t sz2);
+
 			// Function send data through UART port.
 			// ptr: Pointer to data which will be send.
 			// sz: Size of data which will be send.